@@ -0,0 +1,165 @@
+// Compares memcpy with lve::streamingCopy for every host visible memory type
+// of the first vulkan device, plus plain heap memory as a reference.
+//
+// build and run with `make bench`
+
+#include "../lve_memcpy.hpp"
+
+// libs
+#include <vulkan/vulkan.h>
+
+// std
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr size_t MAX_COPY_SIZE = 64 * 1024 * 1024;
+constexpr size_t COPY_SIZES[] = {4 * 1024, 64 * 1024, 1024 * 1024,
+                                 16 * 1024 * 1024, MAX_COPY_SIZE};
+// bytes copied per measurement, so small sizes are repeated more often
+constexpr size_t BYTES_PER_RUN = 256 * 1024 * 1024;
+
+std::string describeMemoryType(VkMemoryPropertyFlags flags) {
+  std::string description;
+  if (flags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) {
+    description += "DEVICE_LOCAL ";
+  }
+  if (flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+    description += "HOST_VISIBLE ";
+  }
+  if (flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) {
+    description += "HOST_COHERENT ";
+  }
+  if (flags & VK_MEMORY_PROPERTY_HOST_CACHED_BIT) {
+    description += "HOST_CACHED ";
+  }
+  return description;
+}
+
+// returns throughput in GB/s
+double measure(const std::function<void(void *, const void *, size_t)> &copy,
+               void *dst, const void *src, size_t size) {
+  size_t iterations = std::max<size_t>(1, BYTES_PER_RUN / size);
+  copy(dst, src, size); // warm up page mappings
+
+  auto start = std::chrono::high_resolution_clock::now();
+  for (size_t i = 0; i < iterations; i++) {
+    copy(dst, src, size);
+  }
+  auto end = std::chrono::high_resolution_clock::now();
+
+  double seconds = std::chrono::duration<double>(end - start).count();
+  return (double)(size * iterations) / seconds / 1e9;
+}
+
+void benchmark(const char *name, void *dst, const void *src) {
+  std::printf("%s\n", name);
+  std::printf("  %10s %12s %12s\n", "size", "memcpy", "streaming");
+  for (size_t size : COPY_SIZES) {
+    double plain = measure(
+        [](void *d, const void *s, size_t n) { std::memcpy(d, s, n); }, dst,
+        src, size);
+    double streaming = measure(lve::streamingCopy, dst, src, size);
+    std::printf("  %8zuKB %9.2fGB/s %9.2fGB/s\n", size / 1024, plain,
+                streaming);
+  }
+}
+
+} // namespace
+
+int main() {
+  VkApplicationInfo appInfo = {};
+  appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+  appInfo.pApplicationName = "BufferCopyBench";
+  appInfo.apiVersion = VK_API_VERSION_1_0;
+
+  VkInstanceCreateInfo instanceInfo = {};
+  instanceInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+  instanceInfo.pApplicationInfo = &appInfo;
+
+  VkInstance instance;
+  if (vkCreateInstance(&instanceInfo, nullptr, &instance) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create instance!");
+  }
+
+  uint32_t deviceCount = 1;
+  VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+  vkEnumeratePhysicalDevices(instance, &deviceCount, &physicalDevice);
+  if (physicalDevice == VK_NULL_HANDLE) {
+    throw std::runtime_error("failed to find GPUs with Vulkan support!");
+  }
+
+  VkPhysicalDeviceProperties properties;
+  vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+  VkPhysicalDeviceMemoryProperties memoryProperties;
+  vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+
+  float queuePriority = 1.0f;
+  VkDeviceQueueCreateInfo queueInfo = {};
+  queueInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+  queueInfo.queueFamilyIndex = 0;
+  queueInfo.queueCount = 1;
+  queueInfo.pQueuePriorities = &queuePriority;
+
+  VkDeviceCreateInfo deviceInfo = {};
+  deviceInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+  deviceInfo.queueCreateInfoCount = 1;
+  deviceInfo.pQueueCreateInfos = &queueInfo;
+
+  VkDevice device;
+  if (vkCreateDevice(physicalDevice, &deviceInfo, nullptr, &device) !=
+      VK_SUCCESS) {
+    throw std::runtime_error("failed to create logical device!");
+  }
+
+  std::printf("device: %s, streaming path: %s\n\n", properties.deviceName,
+              lve::streamingCopyPath());
+
+  std::vector<char> source(MAX_COPY_SIZE);
+  for (size_t i = 0; i < source.size(); i++) {
+    source[i] = (char)(i * 31);
+  }
+
+  std::vector<char> heap(MAX_COPY_SIZE);
+  benchmark("heap memory", heap.data(), source.data());
+
+  for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
+    VkMemoryPropertyFlags flags = memoryProperties.memoryTypes[i].propertyFlags;
+    if (!(flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)) {
+      continue;
+    }
+
+    VkMemoryAllocateInfo allocInfo = {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = MAX_COPY_SIZE;
+    allocInfo.memoryTypeIndex = i;
+
+    VkDeviceMemory memory;
+    if (vkAllocateMemory(device, &allocInfo, nullptr, &memory) != VK_SUCCESS) {
+      std::printf("memory type %u: allocation failed, skipped\n\n", i);
+      continue;
+    }
+    void *mapped;
+    vkMapMemory(device, memory, 0, VK_WHOLE_SIZE, 0, &mapped);
+
+    std::string name = "memory type " + std::to_string(i) + ": " +
+                       describeMemoryType(flags);
+    benchmark(name.c_str(), mapped, source.data());
+    std::printf("\n");
+
+    vkUnmapMemory(device, memory);
+    vkFreeMemory(device, memory, nullptr);
+  }
+
+  vkDestroyDevice(device, nullptr);
+  vkDestroyInstance(instance, nullptr);
+  return 0;
+}
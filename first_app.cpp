@@ -3,6 +3,8 @@
 #include "keyboard_movement_controller.hpp"
 #include "lve_buffer.hpp"
 #include "lve_camera.hpp"
+#include "lve_render_graph.hpp"
+#include "lve_shm_frame_sink.hpp"
 #include "simple_render_system.hpp"
 
 // libs
@@ -15,32 +17,52 @@
 #include <array>
 #include <cassert>
 #include <chrono>
+#include <iostream>
 #include <stdexcept>
 
 namespace lve {
 
+struct PointLight {
+  glm::vec4 position{}; // w is ignored
+  glm::vec4 color{};    // w is intensity
+};
+
 struct GlobalUbo {
   glm::mat4 projectionView{1.f};
   glm::vec4 ambientLightColor{1.f, 1.f, 1.f, 0.02f};
-
-  glm::vec3 lightPosition{-1.f};
-  alignas(16) glm::vec4 lightColor{1.f};
+  PointLight pointLights[MAX_LIGHTS];
 };
 
-FirstApp::FirstApp() {
-  globalPool = LveDescriptorPool::Builder(lveDevice)
-                   .setMaxSets(LveSwapChain::MAX_FRAMES_IN_FLIGHT)
-                   .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-                                LveSwapChain::MAX_FRAMES_IN_FLIGHT)
-                   .build();
+// the first light is the scene's original one, the others ring the vase
+const PointLight sceneLights[MAX_LIGHTS] = {
+    {{-1.f, -1.f, -1.f, 1.f}, {1.f, 1.f, 1.f, 1.f}},
+    {{1.f, -1.f, -1.f, 1.f}, {1.f, .2f, .2f, 1.f}},
+    {{1.f, -1.f, 1.f, 1.f}, {.2f, 1.f, .2f, 1.f}},
+    {{-1.f, -1.f, 1.f, 1.f}, {.2f, .2f, 1.f, 1.f}}};
+
+FirstApp::FirstApp(FirstAppConfig config) : config{config} {
+  lveDevice.getHostAllocator().setCommandArenaEnabled(config.commandArena);
+  globalSetLayout = LveDescriptorSetLayout::Builder(lveDevice)
+                        .addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+                                    VK_SHADER_STAGE_VERTEX_BIT)
+                        .build();
+  createFrameResources();
   loadGameObjects();
 }
 
 FirstApp::~FirstApp() {}
 
-void FirstApp::run() {
-  std::vector<std::unique_ptr<LveBuffer>> uboBuffers(
-      LveSwapChain::MAX_FRAMES_IN_FLIGHT);
+void FirstApp::createFrameResources() {
+  // the old pool and buffers are destroyed once frames using them retire
+  uint32_t framesInFlight = lveRenderer.getFramesInFlight();
+  globalPool = LveDescriptorPool::Builder(lveDevice)
+                   .setMaxSets(framesInFlight)
+                   .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+                                framesInFlight)
+                   .build();
+
+  uboBuffers.clear();
+  uboBuffers.resize(framesInFlight);
   for (int i = 0; i < uboBuffers.size(); i++) {
     uboBuffers[i] = std::make_unique<LveBuffer>(
         lveDevice, sizeof(GlobalUbo), 1, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
@@ -48,68 +70,384 @@ void FirstApp::run() {
     uboBuffers[i]->map();
   }
 
-  auto globalSetLayout = LveDescriptorSetLayout::Builder(lveDevice)
-                             .addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-                                         VK_SHADER_STAGE_VERTEX_BIT)
-                             .build();
-
-  std::vector<VkDescriptorSet> globalDescriptorSets(
-      LveSwapChain::MAX_FRAMES_IN_FLIGHT);
+  globalDescriptorSets.assign(framesInFlight, VK_NULL_HANDLE);
   for (int i = 0; i < globalDescriptorSets.size(); i++) {
     auto bufferInfo = uboBuffers[i]->descriptorInfo();
     LveDescriptorWriter(*globalSetLayout, *globalPool)
         .writeBuffer(0, &bufferInfo)
         .build(globalDescriptorSets[i]);
   }
+}
 
-  SimpleRenderSystem simpleRenderSystem{
-      lveDevice, lveRenderer.getSwapChainRenderPass(),
-      globalSetLayout->getDescriptorSetLayout()};
+void FirstApp::run() {
+  auto shadingFeatures = [&]() {
+    SimpleRenderSystem::ShadingFeatures features{};
+    features.lightingModel = config.unlit
+                                 ? SimpleRenderSystem::LightingModel::Unlit
+                                 : SimpleRenderSystem::LightingModel::Lambert;
+    features.lightCount = config.lightCount;
+    return features;
+  };
+  auto simpleRenderSystem = std::make_unique<SimpleRenderSystem>(
+      lveDevice, pipelineCompiler, lveRenderer.getPipelineTarget(),
+      globalSetLayout->getDescriptorSetLayout(), textureManager,
+      shadingFeatures());
+  uint32_t pipelineTargetVersion = lveRenderer.getPipelineTargetVersion();
   LveCamera camera{};
 
   auto viewerObject = LveGameObject::createGameObject();
   viewerObject.transform.translation.z = -2.5f;
   KeyboardMovementController cameraController{};
 
+  float frameTime = 0.f;
+  // called right after the input it uses was polled
+  auto updateCamera = [&]() {
+    lveRenderer.markInputSampled();
+    if (!config.headless) {
+      cameraController.moveInPlaneXZ(lveWindow.getGLFWwindo(), frameTime,
+                                     viewerObject);
+    }
+    camera.setViewYXZ(viewerObject.transform.translation,
+                      viewerObject.transform.rotation);
+
+    float aspect = lveRenderer.getAspectRatio();
+    camera.setPerspectiveProjection(glm::radians(50.f), aspect, 0.1f, 100.f);
+  };
+
+  auto makeFrameInfo = [&](VkCommandBuffer commandBuffer) {
+    int frameIndex = lveRenderer.getFrameIndex();
+    return FrameInfo{frameIndex,
+                     frameTime,
+                     commandBuffer,
+                     camera,
+                     globalDescriptorSets[frameIndex],
+                     &lveRenderer.getGpuProfiler()};
+  };
+
+  if ((config.dynamicResolution || config.renderScale > 0.0f) &&
+      !lveRenderer.supportsDynamicResolution()) {
+    std::cerr << "dynamic resolution is not supported by the swap chain "
+                 "format, rendering at full resolution"
+              << std::endl;
+  } else if (config.dynamicResolution || config.renderScale > 0.0f) {
+    LveDynamicResolution &dynamicResolution =
+        lveRenderer.getDynamicResolution();
+    LveDynamicResolution::Settings settings{};
+    if (config.targetFps > 0.0) {
+      settings.targetGpuMs = 1000.0 / config.targetFps;
+    }
+    // frame times are read back this many frames late
+    settings.settleFrames = lveRenderer.getFramesInFlight() + 1;
+    dynamicResolution.setSettings(settings);
+    if (config.renderScale > 0.0f) {
+      dynamicResolution.setFixedScale(config.renderScale);
+    }
+    lveRenderer.setDynamicResolution(true);
+  }
+
+  // Without the pre-pass the main pass clears depth itself, nothing reads
+  // what the pre-pass writes and the graph culls it. With dynamic resolution
+  // the scene renders into an offscreen image that is upscaled at the end.
+  LveRenderGraph renderGraph{lveDevice, lveRenderer};
+  bool depthPrepass = config.depthPrepass;
+  auto declareRenderGraph = [&]() {
+    renderGraph.reset();
+    bool dynamicResolution = lveRenderer.usesDynamicResolution();
+    auto backbuffer = renderGraph.importSwapChainImage("backbuffer");
+    auto depth = renderGraph.importSwapChainDepth("depth");
+    auto sceneColor = backbuffer;
+    if (dynamicResolution) {
+      sceneColor = renderGraph.createImage(
+          "scene color", {lveRenderer.getSwapChainImageFormat()});
+    }
+
+    auto depthPass = renderGraph.addPass(
+        "depth prepass", [&](VkCommandBuffer commandBuffer) {
+          FrameInfo frameInfo = makeFrameInfo(commandBuffer);
+          simpleRenderSystem->renderDepthPrepassParallel(frameInfo, gameObjects,
+                                                         lveRenderer);
+        });
+    depthPass.writeDepth(depth, VK_ATTACHMENT_LOAD_OP_CLEAR)
+        .setSecondaryCommandBuffers();
+    auto mainPass = renderGraph.addPass(
+        "main pass", [&](VkCommandBuffer commandBuffer) {
+          FrameInfo frameInfo = makeFrameInfo(commandBuffer);
+          simpleRenderSystem->renderGameObjectsParallel(frameInfo, gameObjects,
+                                                        lveRenderer);
+        });
+    mainPass
+        .writeColor(sceneColor, VK_ATTACHMENT_LOAD_OP_CLEAR,
+                    {{0.01f, 0.01f, 0.01f, 1.0f}})
+        .setSecondaryCommandBuffers();
+    if (depthPrepass) {
+      mainPass.readDepth(depth);
+    } else {
+      mainPass.writeDepth(depth, VK_ATTACHMENT_LOAD_OP_CLEAR);
+    }
+
+    if (dynamicResolution) {
+      depthPass.setDynamicResolution();
+      mainPass.setDynamicResolution();
+      renderGraph
+          .addPass("upscale",
+                   [&, sceneColor](VkCommandBuffer commandBuffer) {
+                     lveRenderer.recordUpscale(
+                         commandBuffer, renderGraph.getImage(sceneColor));
+                   })
+          .copyFrom(sceneColor)
+          .copyTo(backbuffer);
+    }
+
+    renderGraph.compile();
+    simpleRenderSystem->setDepthPrepass(
+        depthPrepass, depthPrepass
+                          ? renderGraph.getPipelineTarget(depthPass.getId())
+                          : PipelineTargetInfo{});
+  };
+  declareRenderGraph();
+
+  // shared with the capture callback, which the renderer keeps past run()
+  std::shared_ptr<LveShmFrameSink> shmSink;
+  if (config.captureFrames) {
+    if (!config.captureShmName.empty()) {
+      VkExtent2D extent = lveWindow.getExtent();
+      shmSink = std::make_shared<LveShmFrameSink>(
+          config.captureShmName, 4,
+          static_cast<uint64_t>(extent.width) * extent.height * 4);
+    }
+    lveRenderer.enableFrameCapture(
+        lveRenderer.getFramesInFlight() + 1,
+        [shmSink](const LveCapturedFrame &frame) {
+          if (shmSink != nullptr) {
+            shmSink->publish(frame);
+          }
+        });
+  }
+
   auto currentTime = std::chrono::high_resolution_clock::now();
+  float textureStatsTimer = 0.f;
+  uint32_t framesRendered = 0;
+  LveFramePacer framePacer{config.targetFps};
+  LveAllocator &hostAllocator = lveDevice.getHostAllocator();
+  uint64_t reportedAllocations = hostAllocator.allocationCount();
+  uint32_t reportedFrames = 0;
   while (!lveWindow.shouldClose()) {
-    glfwPollEvents();
+    if (config.frameCount > 0 && framesRendered >= config.frameCount) {
+      break;
+    }
+    framePacer.waitForNextFrame();
+    auto frameStart = std::chrono::steady_clock::now();
+    if (!config.headless) {
+      glfwPollEvents();
+      handleFrameControls(framePacer);
+    }
 
     auto newTime = std::chrono::high_resolution_clock::now();
-    float frameTime =
+    frameTime =
         std::chrono::duration<float, std::chrono::seconds::period>(newTime -
                                                                    currentTime)
             .count();
     currentTime = newTime;
 
-    cameraController.moveInPlaneXZ(lveWindow.getGLFWwindo(), frameTime,
-                                   viewerObject);
-    camera.setViewYXZ(viewerObject.transform.translation,
-                      viewerObject.transform.rotation);
+    if (!config.lowLatency) {
+      updateCamera();
+    }
 
-    float aspect = lveRenderer.getAspectRatio();
-    camera.setPerspectiveProjection(glm::radians(50.f), aspect, 0.1f, 100.f);
+    for (auto &obj : gameObjects) {
+      if (obj.texture) {
+        obj.texture->markVisible(
+            glm::distance(camera.getPosition(), obj.transform.translation));
+      }
+    }
+    textureManager.update();
+
+    textureStatsTimer += frameTime;
+    if (textureStatsTimer >= 5.f) {
+      textureStatsTimer = 0.f;
+      if (textureManager.getStats().textureCount > 0) {
+        textureManager.printStats();
+      }
+      const auto &syncStats = lveRenderer.getFrameSyncStats();
+      std::cout << "frame sync ("
+                << (lveRenderer.usesTimelineSync() ? "timeline" : "fences")
+                << "): " << syncStats.averageWaitMs()
+                << " ms cpu wait per frame over " << syncStats.frameCount
+                << " frames" << std::endl;
+      framePacer.printStats();
+      frameStats.printStats();
+      const auto &latencyStats = lveRenderer.getInputLatencyStats();
+      if (latencyStats.count() > 0) {
+        std::cout << "input to present"
+                  << (config.lowLatency ? " (low latency)" : "") << ": p50 "
+                  << latencyStats.percentile(50) << " ms  p95 "
+                  << latencyStats.percentile(95) << " ms  p99 "
+                  << latencyStats.percentile(99) << " ms  max "
+                  << latencyStats.max() << " ms" << std::endl;
+      }
+      if (auto *frameCapture = lveRenderer.getFrameCapture()) {
+        frameCapture->printStats();
+      }
+      lveRenderer.getGpuProfiler().printStats();
+      if (lveRenderer.usesDynamicResolution()) {
+        lveRenderer.getDynamicResolution().printStats(
+            lveRenderer.getSwapChainExtent());
+      }
+      simpleRenderSystem->printStats(lveRenderer.getGpuProfiler());
+
+      // the steady state frame loop should not reach the host allocator
+      uint64_t allocations = hostAllocator.allocationCount();
+      std::cout << "host allocations: " << allocations - reportedAllocations
+                << " over " << framesRendered - reportedFrames << " frames"
+                << std::endl;
+      if (allocations != reportedAllocations) {
+        hostAllocator.printStats();
+      }
+      reportedAllocations = allocations;
+      reportedFrames = framesRendered;
+    }
+
+    // a recreated swap chain only rarely changes formats
+    if (lveRenderer.getPipelineTargetVersion() != pipelineTargetVersion) {
+      pipelineTargetVersion = lveRenderer.getPipelineTargetVersion();
+      simpleRenderSystem = std::make_unique<SimpleRenderSystem>(
+          lveDevice, pipelineCompiler, lveRenderer.getPipelineTarget(),
+          globalSetLayout->getDescriptorSetLayout(), textureManager,
+          shadingFeatures());
+      declareRenderGraph();
+    } else if (config.depthPrepass != depthPrepass) {
+      depthPrepass = config.depthPrepass;
+      declareRenderGraph();
+    }
+    if (config.lightCount !=
+        simpleRenderSystem->getShadingFeatures().lightCount) {
+      simpleRenderSystem->setShadingFeatures(shadingFeatures());
+    }
 
     if (auto commandBuffer = lveRenderer.beginFrame()) {
       int frameIndex = lveRenderer.getFrameIndex();
-      FrameInfo frameInfo{frameIndex, frameTime, commandBuffer, camera,
-                          globalDescriptorSets[frameIndex]};
+
+      // beginFrame has waited for the frame's slot and image, input polled
+      // from here on reaches the screen a whole wait sooner
+      if (config.lowLatency) {
+        if (!config.headless) {
+          glfwPollEvents();
+        }
+        updateCamera();
+      }
 
       // update
       GlobalUbo ubo{};
       ubo.projectionView = camera.getProjection() * camera.getView();
+      std::copy(std::begin(sceneLights), std::end(sceneLights),
+                std::begin(ubo.pointLights));
       uboBuffers[frameIndex]->writeToBuffer(&ubo);
       uboBuffers[frameIndex]->flush();
 
       // render
-      lveRenderer.beginSwapChainRenderPass(commandBuffer);
-      simpleRenderSystem.renderGameObjects(frameInfo, gameObjects);
-      lveRenderer.endSwapChainRenderPass(commandBuffer);
+      renderGraph.execute(commandBuffer);
       lveRenderer.endFrame();
+      framesRendered++;
+
+      LveFrameStats::Frame frame = lveRenderer.getLastFrameTimings();
+      frame.totalMs = std::chrono::duration<double, std::milli>(
+                          std::chrono::steady_clock::now() - frameStart)
+                          .count();
+      frameStats.add(frame);
     }
   }
 
   vkDeviceWaitIdle(lveDevice.device());
+  // beginFrame only collects what finished before it, the last frames in
+  // flight are still waiting for delivery
+  if (auto *frameCapture = lveRenderer.getFrameCapture()) {
+    frameCapture->flush();
+    frameCapture->printStats();
+  }
+  if (!config.frameStatsCsv.empty()) {
+    writeFrameStats(config.frameStatsCsv);
+  }
+}
+
+void FirstApp::writeFrameStats(const std::string &path) {
+  std::string histogramPath = path;
+  if (histogramPath.size() > 4 &&
+      histogramPath.compare(histogramPath.size() - 4, 4, ".csv") == 0) {
+    histogramPath.resize(histogramPath.size() - 4);
+  }
+  histogramPath += "_histogram.csv";
+  if (frameStats.writeCsv(path)) {
+    frameStats.writeHistogramCsv(histogramPath);
+  }
+}
+
+// F1 cycles the present mode, F2 toggles the frame limiter, F3 cycles the
+// number of frames in flight, F4 toggles the depth pre-pass, F5 writes the
+// frame stats, F6 cycles the number of point lights
+void FirstApp::handleFrameControls(LveFramePacer &framePacer) {
+  static constexpr VkPresentModeKHR presentModes[] = {
+      VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_MAILBOX_KHR,
+      VK_PRESENT_MODE_FIFO_KHR, VK_PRESENT_MODE_FIFO_RELAXED_KHR};
+  GLFWwindow *window = lveWindow.getGLFWwindo();
+
+  bool presentModeKey = glfwGetKey(window, GLFW_KEY_F1) == GLFW_PRESS;
+  if (presentModeKey && !presentModeKeyDown) {
+    // from the requested mode, an unsupported one falls back to FIFO and
+    // cycling from that would never get past it
+    size_t next = 0;
+    for (size_t i = 0; i < std::size(presentModes); i++) {
+      if (presentModes[i] == lveRenderer.getRequestedPresentMode()) {
+        next = (i + 1) % std::size(presentModes);
+      }
+    }
+    lveRenderer.setPresentMode(presentModes[next]);
+    std::cout << "present mode: "
+              << LveSwapChain::presentModeName(presentModes[next])
+              << std::endl;
+  }
+  presentModeKeyDown = presentModeKey;
+
+  bool frameCapKey = glfwGetKey(window, GLFW_KEY_F2) == GLFW_PRESS;
+  if (frameCapKey && !frameCapKeyDown) {
+    double cap = config.targetFps > 0.0 ? config.targetFps : 60.0;
+    framePacer.setTargetFps(framePacer.isCapped() ? 0.0 : cap);
+    std::cout << "frame limiter: "
+              << (framePacer.isCapped() ? "on" : "off") << std::endl;
+  }
+  frameCapKeyDown = frameCapKey;
+
+  bool framesInFlightKey = glfwGetKey(window, GLFW_KEY_F3) == GLFW_PRESS;
+  if (framesInFlightKey && !framesInFlightKeyDown) {
+    uint32_t framesInFlight = lveRenderer.getFramesInFlight() %
+                                  LveSwapChain::MAX_FRAMES_IN_FLIGHT +
+                              1;
+    lveRenderer.setFramesInFlight(framesInFlight);
+    lveRenderer.getDynamicResolution().setSettleFrames(framesInFlight + 1);
+    createFrameResources();
+    std::cout << "frames in flight: " << framesInFlight << std::endl;
+  }
+  framesInFlightKeyDown = framesInFlightKey;
+
+  bool depthPrepassKey = glfwGetKey(window, GLFW_KEY_F4) == GLFW_PRESS;
+  if (depthPrepassKey && !depthPrepassKeyDown) {
+    config.depthPrepass = !config.depthPrepass;
+    std::cout << "depth prepass: " << (config.depthPrepass ? "on" : "off")
+              << std::endl;
+  }
+  depthPrepassKeyDown = depthPrepassKey;
+
+  bool frameStatsKey = glfwGetKey(window, GLFW_KEY_F5) == GLFW_PRESS;
+  if (frameStatsKey && !frameStatsKeyDown) {
+    writeFrameStats(config.frameStatsCsv.empty() ? "frame_stats.csv"
+                                                 : config.frameStatsCsv);
+  }
+  frameStatsKeyDown = frameStatsKey;
+
+  bool lightCountKey = glfwGetKey(window, GLFW_KEY_F6) == GLFW_PRESS;
+  if (lightCountKey && !lightCountKeyDown) {
+    config.lightCount = (config.lightCount + 1) % (MAX_LIGHTS + 1);
+    std::cout << "point lights: " << config.lightCount << std::endl;
+  }
+  lightCountKeyDown = lightCountKey;
 }
 
 void FirstApp::loadGameObjects() {
@@ -133,6 +471,7 @@ void FirstApp::loadGameObjects() {
   floor.model = lveModel;
   floor.transform.translation = {0.f, .5f, 0.f};
   floor.transform.scale = {3.f, 1.f, 3.f};
+  floor.texture = textureManager.loadTexture("textures/checker.png");
   gameObjects.push_back(std::move(floor));
 }
 
@@ -1,23 +1,69 @@
 #pragma once
 
 #include "game_object.hpp"
+#include "lve_buffer.hpp"
 #include "lve_descriptors.hpp"
 #include "lve_device.hpp"
+#include "lve_frame_info.hpp"
+#include "lve_frame_pacer.hpp"
+#include "lve_frame_stats.hpp"
+#include "lve_pipeline_compiler.hpp"
 #include "lve_renderer.hpp"
+#include "lve_texture.hpp"
+#include "lve_thread_pool.hpp"
 #include "lve_window.hpp"
 
 #include <algorithm>
 #include <memory>
+#include <string>
 #include <vector>
 #include <vulkan/vulkan_core.h>
 
 namespace lve {
+struct FirstAppConfig {
+  // render offscreen without a window, surface or swap chain
+  bool headless = false;
+  // stop after this many frames, 0 runs until the window is closed
+  uint32_t frameCount = 0;
+  // use vkCmdBeginRendering when the device supports it
+  bool dynamicRendering = false;
+  // pace frames on one timeline semaphore instead of per frame fences
+  bool timelineSync = false;
+  // count vertex and fragment work per render system
+  bool pipelineStatistics = false;
+  // bump allocate command scope driver allocations instead of using malloc
+  bool commandArena = true;
+  // immediate for lowest latency, fifo or fifo relaxed for smooth pacing
+  VkPresentModeKHR presentMode = VK_PRESENT_MODE_MAILBOX_KHR;
+  // cpu frame limiter, 0 leaves the frame rate uncapped
+  double targetFps = 0.0;
+  // more frames in flight trade latency for throughput on CPU bound loads
+  uint32_t framesInFlight = LveSwapChain::DEFAULT_FRAMES_IN_FLIGHT;
+  // read every headless frame back, optionally into a shared memory ring
+  bool captureFrames = false;
+  std::string captureShmName;
+  // lay down depth first so the color pass shades every pixel once
+  bool depthPrepass = false;
+  // render the scene at a scale that follows GPU frame time and upscale it,
+  // a renderScale above 0 fixes the scale instead
+  bool dynamicResolution = false;
+  float renderScale = 0.0f;
+  // sample input and update the camera after the wait for a free frame
+  // instead of before it
+  bool lowLatency = false;
+  // per frame timings are written here on exit, F5 writes them any time
+  std::string frameStatsCsv;
+  // shading variant, up to MAX_LIGHTS point lights, F6 cycles the count
+  uint32_t lightCount = 1;
+  bool unlit = false;
+};
+
 class FirstApp {
 public:
   static constexpr int WIDTH = 800;
   static constexpr int HEIGHT = 600;
 
-  FirstApp();
+  FirstApp(FirstAppConfig config = {});
   ~FirstApp();
 
   FirstApp(const FirstApp &) = delete;
@@ -27,12 +73,39 @@ public:
 
 private:
   void loadGameObjects();
+  // per frame uniform buffers and descriptor sets, sized from the renderer's
+  // frames in flight
+  void createFrameResources();
+  void handleFrameControls(LveFramePacer &framePacer);
+  // the frames to path and their histograms next to it
+  void writeFrameStats(const std::string &path);
 
-  LveWindow lveWindow{WIDTH, HEIGHT, "Hello Vulkan!"};
-  LveDevice lveDevice{lveWindow};
-  LveRenderer lveRenderer{lveWindow, lveDevice};
+  FirstAppConfig config;
+  LveWindow lveWindow{WIDTH, HEIGHT, "Hello Vulkan!", config.headless};
+  LveDevice lveDevice{lveWindow,
+                      {config.dynamicRendering, config.timelineSync,
+                       config.pipelineStatistics}};
+  // pipeline compiles and texture decodes, frame recording has its own
+  // workers so a long background job never holds up a frame
+  LveThreadPool threadPool{};
+  LveThreadPool recordingThreadPool{};
+  LveRenderer lveRenderer{lveWindow, lveDevice, recordingThreadPool,
+                          config.presentMode, config.framesInFlight};
+  LvePipelineCompiler pipelineCompiler{lveDevice, threadPool};
+  LveTextureManager textureManager{lveDevice, threadPool};
 
   std::unique_ptr<LveDescriptorPool> globalPool{};
+  std::unique_ptr<LveDescriptorSetLayout> globalSetLayout{};
+  std::vector<std::unique_ptr<LveBuffer>> uboBuffers;
+  std::vector<VkDescriptorSet> globalDescriptorSets;
   std::vector<LveGameObject> gameObjects;
+  LveFrameStats frameStats{};
+
+  bool presentModeKeyDown = false;
+  bool frameCapKeyDown = false;
+  bool framesInFlightKeyDown = false;
+  bool depthPrepassKeyDown = false;
+  bool frameStatsKeyDown = false;
+  bool lightCountKeyDown = false;
 };
 } // namespace lve
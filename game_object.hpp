@@ -1,5 +1,6 @@
 #pragma once
 #include "lve_model.hpp"
+#include "lve_texture.hpp"
 // std
 #include <glm/ext/matrix_transform.hpp>
 #include <glm/gtc/matrix_transform.hpp>
@@ -33,6 +34,7 @@ public:
   LveGameObject &operator=(LveGameObject &&) = default;
   id_t getId() { return id; }
   std::shared_ptr<LveModel> model{};
+  std::shared_ptr<LveTexture> texture{};
   glm::vec3 color{};
   TransformComponent transform{};
 
@@ -0,0 +1,245 @@
+#include "lve_allocator.hpp"
+
+// std
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+namespace lve {
+
+namespace {
+
+struct CommandArena {
+  unsigned char *memory = nullptr;
+  size_t offset = 0;
+  size_t liveCount = 0;
+
+  ~CommandArena() { std::free(memory); }
+};
+
+thread_local CommandArena commandArena;
+
+// stored directly in front of every pointer handed to the driver
+struct AllocationHeader {
+  void *base;            // malloc result, null for arena allocations
+  CommandArena *arena;   // owning arena, null for heap allocations
+  size_t size;
+  VkSystemAllocationScope scope;
+};
+
+AllocationHeader *headerOf(void *memory) {
+  return reinterpret_cast<AllocationHeader *>(memory) - 1;
+}
+
+uintptr_t alignUp(uintptr_t value, size_t alignment) {
+  return (value + alignment - 1) & ~(uintptr_t(alignment) - 1);
+}
+
+void updatePeak(std::atomic<uint64_t> &peak, uint64_t value) {
+  uint64_t current = peak.load(std::memory_order_relaxed);
+  while (value > current &&
+         !peak.compare_exchange_weak(current, value,
+                                     std::memory_order_relaxed)) {
+  }
+}
+
+} // namespace
+
+LveAllocator::LveAllocator() {
+  allocationCallbacks.pUserData = this;
+  allocationCallbacks.pfnAllocation = allocationFunction;
+  allocationCallbacks.pfnReallocation = reallocationFunction;
+  allocationCallbacks.pfnFree = freeFunction;
+  allocationCallbacks.pfnInternalAllocation = internalAllocationNotification;
+  allocationCallbacks.pfnInternalFree = internalFreeNotification;
+}
+
+void *LveAllocator::allocate(size_t size, size_t alignment,
+                             VkSystemAllocationScope scope) {
+  if (size == 0) {
+    return nullptr;
+  }
+  alignment = std::max(alignment, alignof(AllocationHeader));
+  const size_t headerSize = sizeof(AllocationHeader);
+
+  void *base = nullptr;
+  CommandArena *arena = nullptr;
+  uintptr_t address = 0;
+
+  if (scope == VK_SYSTEM_ALLOCATION_SCOPE_COMMAND && commandArenaEnabled) {
+    CommandArena &local = commandArena;
+    if (local.memory == nullptr) {
+      local.memory =
+          static_cast<unsigned char *>(std::malloc(COMMAND_ARENA_SIZE));
+    }
+    if (local.memory != nullptr) {
+      uintptr_t start = reinterpret_cast<uintptr_t>(local.memory);
+      uintptr_t candidate = alignUp(start + local.offset + headerSize,
+                                    alignment);
+      if (candidate + size - start <= COMMAND_ARENA_SIZE) {
+        arena = &local;
+        address = candidate;
+        local.offset = candidate + size - start;
+        local.liveCount++;
+      }
+    }
+  }
+
+  if (arena == nullptr) {
+    // arena disabled or exhausted, fall back to the heap
+    base = std::malloc(size + alignment + headerSize);
+    if (base == nullptr) {
+      return nullptr;
+    }
+    address = alignUp(reinterpret_cast<uintptr_t>(base) + headerSize,
+                      alignment);
+  }
+
+  void *memory = reinterpret_cast<void *>(address);
+  *headerOf(memory) = {base, arena, size, scope};
+
+  ScopeCounters &scopeCounters = counters[scope];
+  scopeCounters.allocations.fetch_add(1, std::memory_order_relaxed);
+  if (arena != nullptr) {
+    scopeCounters.arenaAllocations.fetch_add(1, std::memory_order_relaxed);
+  }
+  uint64_t live =
+      scopeCounters.liveBytes.fetch_add(size, std::memory_order_relaxed) +
+      size;
+  updatePeak(scopeCounters.peakBytes, live);
+  return memory;
+}
+
+void LveAllocator::free(void *memory) {
+  if (memory == nullptr) {
+    return;
+  }
+  AllocationHeader header = *headerOf(memory);
+
+  ScopeCounters &scopeCounters = counters[header.scope];
+  scopeCounters.frees.fetch_add(1, std::memory_order_relaxed);
+  scopeCounters.liveBytes.fetch_sub(header.size, std::memory_order_relaxed);
+
+  if (header.arena != nullptr) {
+    // command scope memory is released before the command returns, so the
+    // arena can rewind as soon as nothing in it is alive
+    if (--header.arena->liveCount == 0) {
+      header.arena->offset = 0;
+    }
+    return;
+  }
+  std::free(header.base);
+}
+
+VKAPI_ATTR void *VKAPI_CALL
+LveAllocator::allocationFunction(void *userData, size_t size,
+                                 size_t alignment,
+                                 VkSystemAllocationScope scope) {
+  return static_cast<LveAllocator *>(userData)->allocate(size, alignment,
+                                                         scope);
+}
+
+VKAPI_ATTR void *VKAPI_CALL LveAllocator::reallocationFunction(
+    void *userData, void *original, size_t size, size_t alignment,
+    VkSystemAllocationScope scope) {
+  auto *allocator = static_cast<LveAllocator *>(userData);
+  if (original == nullptr) {
+    return allocator->allocate(size, alignment, scope);
+  }
+  if (size == 0) {
+    allocator->free(original);
+    return nullptr;
+  }
+
+  void *memory = allocator->allocate(size, alignment, scope);
+  if (memory == nullptr) {
+    return nullptr;
+  }
+  std::memcpy(memory, original, std::min(size, headerOf(original)->size));
+  allocator->free(original);
+  allocator->counters[scope].reallocations.fetch_add(
+      1, std::memory_order_relaxed);
+  return memory;
+}
+
+VKAPI_ATTR void VKAPI_CALL LveAllocator::freeFunction(void *userData,
+                                                      void *memory) {
+  static_cast<LveAllocator *>(userData)->free(memory);
+}
+
+VKAPI_ATTR void VKAPI_CALL LveAllocator::internalAllocationNotification(
+    void *userData, size_t size, VkInternalAllocationType,
+    VkSystemAllocationScope scope) {
+  auto *allocator = static_cast<LveAllocator *>(userData);
+  allocator->counters[scope].internalBytes.fetch_add(
+      size, std::memory_order_relaxed);
+}
+
+VKAPI_ATTR void VKAPI_CALL LveAllocator::internalFreeNotification(
+    void *userData, size_t size, VkInternalAllocationType,
+    VkSystemAllocationScope scope) {
+  auto *allocator = static_cast<LveAllocator *>(userData);
+  allocator->counters[scope].internalBytes.fetch_sub(
+      size, std::memory_order_relaxed);
+}
+
+std::array<LveAllocator::ScopeStats, LveAllocator::SCOPE_COUNT>
+LveAllocator::getStats() const {
+  std::array<ScopeStats, SCOPE_COUNT> stats{};
+  for (size_t i = 0; i < SCOPE_COUNT; i++) {
+    const ScopeCounters &c = counters[i];
+    stats[i].allocations = c.allocations.load(std::memory_order_relaxed);
+    stats[i].reallocations = c.reallocations.load(std::memory_order_relaxed);
+    stats[i].frees = c.frees.load(std::memory_order_relaxed);
+    stats[i].arenaAllocations =
+        c.arenaAllocations.load(std::memory_order_relaxed);
+    stats[i].liveBytes = c.liveBytes.load(std::memory_order_relaxed);
+    stats[i].peakBytes = c.peakBytes.load(std::memory_order_relaxed);
+    stats[i].internalBytes = c.internalBytes.load(std::memory_order_relaxed);
+  }
+  return stats;
+}
+
+uint64_t LveAllocator::allocationCount() const {
+  uint64_t count = 0;
+  for (const ScopeCounters &c : counters) {
+    count += c.allocations.load(std::memory_order_relaxed);
+  }
+  return count;
+}
+
+void LveAllocator::printStats() const {
+  auto stats = getStats();
+  std::cout << "host allocations by scope:\n";
+  for (size_t i = 0; i < SCOPE_COUNT; i++) {
+    const ScopeStats &s = stats[i];
+    if (s.allocations == 0 && s.internalBytes == 0) {
+      continue;
+    }
+    std::cout << "  " << scopeName(static_cast<VkSystemAllocationScope>(i))
+              << ": " << s.allocations << " allocs (" << s.arenaAllocations
+              << " arena, " << s.reallocations << " reallocs), " << s.frees
+              << " frees, " << s.liveBytes << " bytes live, " << s.peakBytes
+              << " peak, " << s.internalBytes << " internal\n";
+  }
+}
+
+const char *LveAllocator::scopeName(VkSystemAllocationScope scope) {
+  switch (scope) {
+  case VK_SYSTEM_ALLOCATION_SCOPE_COMMAND:
+    return "command";
+  case VK_SYSTEM_ALLOCATION_SCOPE_OBJECT:
+    return "object";
+  case VK_SYSTEM_ALLOCATION_SCOPE_CACHE:
+    return "cache";
+  case VK_SYSTEM_ALLOCATION_SCOPE_DEVICE:
+    return "device";
+  case VK_SYSTEM_ALLOCATION_SCOPE_INSTANCE:
+    return "instance";
+  default:
+    return "unknown";
+  }
+}
+
+} // namespace lve
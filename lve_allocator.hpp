@@ -0,0 +1,88 @@
+#pragma once
+
+#include <vulkan/vulkan_core.h>
+
+// std
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace lve {
+
+// Host allocation callbacks handed to every Vulkan create and destroy call.
+// Counts allocations and bytes per VkSystemAllocationScope. Command scope
+// allocations only live for the duration of one Vulkan call, so they can be
+// bump allocated from a small per thread arena that rewinds whenever its last
+// allocation is freed.
+class LveAllocator {
+public:
+  static constexpr size_t SCOPE_COUNT = VK_SYSTEM_ALLOCATION_SCOPE_INSTANCE + 1;
+  static constexpr size_t COMMAND_ARENA_SIZE = 64 * 1024;
+
+  struct ScopeStats {
+    uint64_t allocations = 0;
+    uint64_t reallocations = 0;
+    uint64_t frees = 0;
+    uint64_t arenaAllocations = 0;
+    uint64_t liveBytes = 0;
+    uint64_t peakBytes = 0;
+    // reported by the driver, not allocated through these callbacks
+    uint64_t internalBytes = 0;
+  };
+
+  LveAllocator();
+
+  LveAllocator(const LveAllocator &) = delete;
+  LveAllocator &operator=(const LveAllocator &) = delete;
+
+  const VkAllocationCallbacks *callbacks() const {
+    return &allocationCallbacks;
+  }
+
+  void setCommandArenaEnabled(bool enabled) { commandArenaEnabled = enabled; }
+  bool isCommandArenaEnabled() const { return commandArenaEnabled; }
+
+  std::array<ScopeStats, SCOPE_COUNT> getStats() const;
+  // allocations over all scopes (reallocations included), for frame deltas
+  uint64_t allocationCount() const;
+  void printStats() const;
+
+  static const char *scopeName(VkSystemAllocationScope scope);
+
+private:
+  struct ScopeCounters {
+    std::atomic<uint64_t> allocations{0};
+    std::atomic<uint64_t> reallocations{0};
+    std::atomic<uint64_t> frees{0};
+    std::atomic<uint64_t> arenaAllocations{0};
+    std::atomic<uint64_t> liveBytes{0};
+    std::atomic<uint64_t> peakBytes{0};
+    std::atomic<uint64_t> internalBytes{0};
+  };
+
+  static VKAPI_ATTR void *VKAPI_CALL
+  allocationFunction(void *userData, size_t size, size_t alignment,
+                     VkSystemAllocationScope scope);
+  static VKAPI_ATTR void *VKAPI_CALL
+  reallocationFunction(void *userData, void *original, size_t size,
+                       size_t alignment, VkSystemAllocationScope scope);
+  static VKAPI_ATTR void VKAPI_CALL freeFunction(void *userData,
+                                                 void *memory);
+  static VKAPI_ATTR void VKAPI_CALL
+  internalAllocationNotification(void *userData, size_t size,
+                                 VkInternalAllocationType type,
+                                 VkSystemAllocationScope scope);
+  static VKAPI_ATTR void VKAPI_CALL
+  internalFreeNotification(void *userData, size_t size,
+                           VkInternalAllocationType type,
+                           VkSystemAllocationScope scope);
+
+  void *allocate(size_t size, size_t alignment, VkSystemAllocationScope scope);
+  void free(void *memory);
+
+  std::array<ScopeCounters, SCOPE_COUNT> counters;
+  std::atomic<bool> commandArenaEnabled{true};
+  VkAllocationCallbacks allocationCallbacks{};
+};
+
+} // namespace lve
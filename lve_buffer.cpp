@@ -6,6 +6,7 @@
  */
 
 #include "lve_buffer.hpp"
+#include "lve_memcpy.hpp"
 
 // std
 #include <cassert>
@@ -42,12 +43,30 @@ LveBuffer::LveBuffer(LveDevice &device, VkDeviceSize instanceSize,
   bufferSize = alignmentSize * instanceCount;
   device.createBuffer(bufferSize, usageFlags, memoryPropertyFlags, buffer,
                       memory);
+
+  // the memory type actually picked may have more flags than requested
+  VkMemoryRequirements memRequirements;
+  vkGetBufferMemoryRequirements(device.device(), buffer, &memRequirements);
+  uint32_t memoryType = device.findMemoryType(memRequirements.memoryTypeBits,
+                                              memoryPropertyFlags);
+  VkMemoryPropertyFlags typeFlags =
+      device.memoryProperties.memoryTypes[memoryType].propertyFlags;
+  writeCombined = (typeFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) &&
+                  !(typeFlags & VK_MEMORY_PROPERTY_HOST_CACHED_BIT);
 }
 
 LveBuffer::~LveBuffer() {
   unmap();
-  vkDestroyBuffer(lveDevice.device(), buffer, nullptr);
-  vkFreeMemory(lveDevice.device(), memory, nullptr);
+
+  // frames in flight may still read from the buffer
+  VkDevice device = lveDevice.device();
+  VkBuffer buffer = this->buffer;
+  VkDeviceMemory memory = this->memory;
+  const VkAllocationCallbacks *allocator = lveDevice.allocator();
+  lveDevice.deferDestruction([device, buffer, memory, allocator]() {
+    vkDestroyBuffer(device, buffer, allocator);
+    vkFreeMemory(device, memory, allocator);
+  });
 }
 
 /**
@@ -81,6 +100,9 @@ void LveBuffer::unmap() {
  * Copies the specified data to the mapped buffer. Default value writes whole
  * buffer range
  *
+ * @note Large writes into uncached (write-combined) memory use non-temporal
+ * streaming stores instead of memcpy
+ *
  * @param data Pointer to the data to copy
  * @param size (Optional) Size of the data to copy. Pass VK_WHOLE_SIZE to flush
  * the complete buffer range.
@@ -91,11 +113,16 @@ void LveBuffer::writeToBuffer(void *data, VkDeviceSize size,
                               VkDeviceSize offset) {
   assert(mapped && "Cannot copy to unmapped buffer");
 
+  char *memOffset = (char *)mapped;
   if (size == VK_WHOLE_SIZE) {
-    memcpy(mapped, data, bufferSize);
+    size = bufferSize;
   } else {
-    char *memOffset = (char *)mapped;
     memOffset += offset;
+  }
+
+  if (writeCombined && size >= STREAMING_COPY_THRESHOLD) {
+    streamingCopy(memOffset, data, size);
+  } else {
     memcpy(memOffset, data, size);
   }
 }
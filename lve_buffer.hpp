@@ -41,6 +41,7 @@ public:
     return memoryPropertyFlags;
   }
   VkDeviceSize getBufferSize() const { return bufferSize; }
+  bool isWriteCombined() const { return writeCombined; }
 
 private:
   static VkDeviceSize getAlignment(VkDeviceSize instanceSize,
@@ -57,6 +58,7 @@ private:
   VkDeviceSize alignmentSize;
   VkBufferUsageFlags usageFlags;
   VkMemoryPropertyFlags memoryPropertyFlags;
+  bool writeCombined = false;
 };
 
 } // namespace lve
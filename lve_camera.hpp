@@ -23,9 +23,18 @@ public:
 
   const glm::mat4 getProjection() const { return projectionMatrix; }
   const glm::mat4 getView() const { return viewMatrix; }
+  const glm::mat4 getInverseView() const { return inverseViewMatrix; }
+  const glm::vec3 getPosition() const {
+    return glm::vec3(inverseViewMatrix[3]);
+  }
 
 private:
+  // the view rotation transposed, with the camera position as translation
+  void setInverseView(glm::vec3 u, glm::vec3 v, glm::vec3 w,
+                      glm::vec3 position);
+
   glm::mat4 projectionMatrix{1.f};
   glm::mat4 viewMatrix{1.f};
+  glm::mat4 inverseViewMatrix{1.f};
 };
 } // namespace lve
@@ -45,7 +45,7 @@ LveDescriptorSetLayout::LveDescriptorSetLayout(
   descriptorSetLayoutInfo.pBindings = setLayoutBindings.data();
 
   if (vkCreateDescriptorSetLayout(lveDevice.device(), &descriptorSetLayoutInfo,
-                                  nullptr,
+                                  lveDevice.allocator(),
                                   &descriptorSetLayout) != VK_SUCCESS) {
     throw std::runtime_error("failed to create descriptor set layout!");
   }
@@ -53,7 +53,7 @@ LveDescriptorSetLayout::LveDescriptorSetLayout(
 
 LveDescriptorSetLayout::~LveDescriptorSetLayout() {
   vkDestroyDescriptorSetLayout(lveDevice.device(), descriptorSetLayout,
-                               nullptr);
+                               lveDevice.allocator());
 }
 
 // *************** Descriptor Pool Builder *********************
@@ -95,14 +95,20 @@ LveDescriptorPool::LveDescriptorPool(
   descriptorPoolInfo.maxSets = maxSets;
   descriptorPoolInfo.flags = poolFlags;
 
-  if (vkCreateDescriptorPool(lveDevice.device(), &descriptorPoolInfo, nullptr,
+  if (vkCreateDescriptorPool(lveDevice.device(), &descriptorPoolInfo,
+                             lveDevice.allocator(),
                              &descriptorPool) != VK_SUCCESS) {
     throw std::runtime_error("failed to create descriptor pool!");
   }
 }
 
 LveDescriptorPool::~LveDescriptorPool() {
-  vkDestroyDescriptorPool(lveDevice.device(), descriptorPool, nullptr);
+  VkDevice device = lveDevice.device();
+  VkDescriptorPool descriptorPool = this->descriptorPool;
+  const VkAllocationCallbacks *allocator = lveDevice.allocator();
+  lveDevice.deferDestruction([device, descriptorPool, allocator]() {
+    vkDestroyDescriptorPool(device, descriptorPool, allocator);
+  });
 }
 
 bool LveDescriptorPool::allocateDescriptor(
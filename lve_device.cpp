@@ -1,8 +1,13 @@
 #include "lve_device.hpp"
+#include "lve_startup_profiler.hpp"
 
 // std headers
+#include <algorithm>
+#include <cstdio>
 #include <cstring>
+#include <fstream>
 #include <iostream>
+#include <limits>
 #include <set>
 #include <unordered_set>
 
@@ -43,28 +48,57 @@ void DestroyDebugUtilsMessengerEXT(VkInstance instance,
 }
 
 // class member functions
-LveDevice::LveDevice(LveWindow &window) : window{window} {
+LveDevice::LveDevice(LveWindow &window, LveDeviceFeatures requested)
+    : window{window}, requestedFeatures{requested} {
+  if (isHeadless()) {
+    deviceExtensions.clear();
+  }
   createInstance();
   setupDebugMessenger();
   createSurface();
   pickPhysicalDevice();
   createLogicalDevice();
+  createPipelineCache();
+  createFrameTimeline();
   createCommandPool();
+  createTransferCommandPool();
 }
 
 LveDevice::~LveDevice() {
-  vkDestroyCommandPool(device_, commandPool, nullptr);
-  vkDestroyDevice(device_, nullptr);
+  vkDeviceWaitIdle(device_);
+  retireTransfers();
+  runDeleters(std::numeric_limits<uint64_t>::max());
+  for (auto fence : freeTransferFences) {
+    vkDestroyFence(device_, fence, allocator());
+  }
+  for (auto semaphore : signaledTransferSemaphores) {
+    vkDestroySemaphore(device_, semaphore, allocator());
+  }
+  for (auto semaphore : freeTransferSemaphores) {
+    vkDestroySemaphore(device_, semaphore, allocator());
+  }
+
+  vkDestroyCommandPool(device_, transferCommandPool, allocator());
+  vkDestroyCommandPool(device_, commandPool, allocator());
+  savePipelineCache();
+  vkDestroyPipelineCache(device_, pipelineCache_, allocator());
+  if (frameTimeline != VK_NULL_HANDLE) {
+    vkDestroySemaphore(device_, frameTimeline, allocator());
+  }
+  vkDestroyDevice(device_, allocator());
 
   if (enableValidationLayers) {
-    DestroyDebugUtilsMessengerEXT(instance, debugMessenger, nullptr);
+    DestroyDebugUtilsMessengerEXT(instance, debugMessenger, allocator());
   }
 
-  vkDestroySurfaceKHR(instance, surface_, nullptr);
-  vkDestroyInstance(instance, nullptr);
+  if (surface_ != VK_NULL_HANDLE) {
+    vkDestroySurfaceKHR(instance, surface_, allocator());
+  }
+  vkDestroyInstance(instance, allocator());
 }
 
 void LveDevice::createInstance() {
+  LveStartupProfiler::Scope profile{"LveDevice::createInstance"};
   if (enableValidationLayers && !checkValidationLayerSupport()) {
     throw std::runtime_error("validation layers requested, but not available!");
   }
@@ -75,7 +109,24 @@ void LveDevice::createInstance() {
   appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
   appInfo.pEngineName = "No Engine";
   appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-  appInfo.apiVersion = VK_API_VERSION_1_0;
+  if (requestedFeatures.dynamicRendering ||
+      requestedFeatures.timelineSemaphore) {
+    // timeline semaphores are core in 1.2, dynamic rendering in 1.3 and its
+    // extension needs 1.2 for its dependencies
+    auto enumerateInstanceVersion =
+        reinterpret_cast<PFN_vkEnumerateInstanceVersion>(
+            vkGetInstanceProcAddr(nullptr, "vkEnumerateInstanceVersion"));
+    uint32_t loaderVersion = VK_API_VERSION_1_0;
+    if (enumerateInstanceVersion != nullptr) {
+      enumerateInstanceVersion(&loaderVersion);
+    }
+    if (loaderVersion >= VK_API_VERSION_1_3) {
+      instanceApiVersion = VK_API_VERSION_1_3;
+    } else if (loaderVersion >= VK_API_VERSION_1_2) {
+      instanceApiVersion = VK_API_VERSION_1_2;
+    }
+  }
+  appInfo.apiVersion = instanceApiVersion;
 
   VkInstanceCreateInfo createInfo = {};
   createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -98,7 +149,7 @@ void LveDevice::createInstance() {
     createInfo.pNext = nullptr;
   }
 
-  if (vkCreateInstance(&createInfo, nullptr, &instance) != VK_SUCCESS) {
+  if (vkCreateInstance(&createInfo, allocator(), &instance) != VK_SUCCESS) {
     throw std::runtime_error("failed to create instance!");
   }
 
@@ -106,6 +157,7 @@ void LveDevice::createInstance() {
 }
 
 void LveDevice::pickPhysicalDevice() {
+  LveStartupProfiler::Scope profile{"LveDevice::pickPhysicalDevice"};
   uint32_t deviceCount = 0;
   vkEnumeratePhysicalDevices(instance, &deviceCount, nullptr);
   if (deviceCount == 0) {
@@ -127,28 +179,134 @@ void LveDevice::pickPhysicalDevice() {
   }
 
   vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+  vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
   std::cout << "physical device: " << properties.deviceName << std::endl;
+
+  queueFamilyIndices = findQueueFamilies(physicalDevice);
+  findTransferQueue(physicalDevice, queueFamilyIndices);
+  queryOptionalFeatures();
+
+  uint32_t queueFamilyCount = 0;
+  vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount,
+                                           nullptr);
+  std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+  vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount,
+                                           queueFamilies.data());
+  graphicsTimestampValidBits =
+      queueFamilies[queueFamilyIndices.graphicsFamily].timestampValidBits;
+}
+
+void LveDevice::queryOptionalFeatures() {
+  if (requestedFeatures.pipelineStatistics) {
+    VkPhysicalDeviceFeatures supportedFeatures;
+    vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+    pipelineStatisticsEnabled = supportedFeatures.pipelineStatisticsQuery;
+    std::cout << "pipeline statistics: "
+              << (pipelineStatisticsEnabled ? "enabled" : "unsupported")
+              << std::endl;
+  }
+
+  if (!requestedFeatures.dynamicRendering &&
+      !requestedFeatures.timelineSemaphore) {
+    return;
+  }
+
+  uint32_t apiVersion = std::min(properties.apiVersion, instanceApiVersion);
+  if (apiVersion < VK_API_VERSION_1_2) {
+    std::cout << "optional features: device or loader below Vulkan 1.2, "
+                 "using 1.0 paths"
+              << std::endl;
+    return;
+  }
+
+  bool core = apiVersion >= VK_API_VERSION_1_3;
+  bool extension = false;
+  if (!core && requestedFeatures.dynamicRendering) {
+    uint32_t extensionCount;
+    vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr,
+                                         &extensionCount, nullptr);
+    std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr,
+                                         &extensionCount,
+                                         availableExtensions.data());
+    for (const auto &available : availableExtensions) {
+      if (strcmp(available.extensionName,
+                 VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME) == 0) {
+        extension = true;
+        break;
+      }
+    }
+  }
+
+  VkPhysicalDeviceTimelineSemaphoreFeatures timelineFeatures{};
+  timelineFeatures.sType =
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+  VkPhysicalDeviceDynamicRenderingFeatures dynamicRenderingFeatures{};
+  dynamicRenderingFeatures.sType =
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES;
+  // the dynamic rendering struct is only known to 1.3 or extension drivers
+  if (core || extension) {
+    timelineFeatures.pNext = &dynamicRenderingFeatures;
+  }
+  VkPhysicalDeviceFeatures2 features{};
+  features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+  features.pNext = &timelineFeatures;
+  vkGetPhysicalDeviceFeatures2(physicalDevice, &features);
+
+  timelineSemaphoreSupported = requestedFeatures.timelineSemaphore &&
+                               timelineFeatures.timelineSemaphore;
+  dynamicRenderingEnabled = requestedFeatures.dynamicRendering &&
+                            (core || extension) &&
+                            dynamicRenderingFeatures.dynamicRendering;
+  dynamicRenderingUsesExtension = dynamicRenderingEnabled && !core;
+  if (dynamicRenderingUsesExtension) {
+    deviceExtensions.push_back(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME);
+  }
+
+  if (requestedFeatures.timelineSemaphore) {
+    std::cout << "frame sync: "
+              << (timelineSemaphoreSupported ? "timeline semaphore"
+                                             : "fences (timeline unsupported)")
+              << std::endl;
+  }
+  if (!requestedFeatures.dynamicRendering) {
+    return;
+  }
+  if (!dynamicRenderingEnabled) {
+    std::cout << "dynamic rendering: unsupported, using render passes"
+              << std::endl;
+  } else {
+    std::cout << "dynamic rendering: "
+              << (dynamicRenderingUsesExtension ? "VK_KHR_dynamic_rendering"
+                                                : "Vulkan 1.3")
+              << std::endl;
+  }
 }
 
 void LveDevice::createLogicalDevice() {
-  QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
+  LveStartupProfiler::Scope profile{"LveDevice::createLogicalDevice"};
+  QueueFamilyIndices indices = queueFamilyIndices;
 
   std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-  std::set<uint32_t> uniqueQueueFamilies = {indices.graphicsFamily,
-                                            indices.presentFamily};
+  std::set<uint32_t> uniqueQueueFamilies = {
+      indices.graphicsFamily, indices.presentFamily, indices.transferFamily};
 
-  float queuePriority = 1.0f;
+  float queuePriorities[] = {1.0f, 1.0f};
   for (uint32_t queueFamily : uniqueQueueFamilies) {
     VkDeviceQueueCreateInfo queueCreateInfo = {};
     queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
     queueCreateInfo.queueFamilyIndex = queueFamily;
     queueCreateInfo.queueCount = 1;
-    queueCreateInfo.pQueuePriorities = &queuePriority;
+    if (queueFamily == indices.transferFamily) {
+      queueCreateInfo.queueCount = indices.transferQueueIndex + 1;
+    }
+    queueCreateInfo.pQueuePriorities = queuePriorities;
     queueCreateInfos.push_back(queueCreateInfo);
   }
 
   VkPhysicalDeviceFeatures deviceFeatures = {};
   deviceFeatures.samplerAnisotropy = VK_TRUE;
+  deviceFeatures.pipelineStatisticsQuery = pipelineStatisticsEnabled;
 
   VkDeviceCreateInfo createInfo = {};
   createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -158,6 +316,27 @@ void LveDevice::createLogicalDevice() {
   createInfo.pQueueCreateInfos = queueCreateInfos.data();
 
   createInfo.pEnabledFeatures = &deviceFeatures;
+
+  VkPhysicalDeviceDynamicRenderingFeatures dynamicRenderingFeatures{};
+  dynamicRenderingFeatures.sType =
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES;
+  dynamicRenderingFeatures.dynamicRendering = VK_TRUE;
+  VkPhysicalDeviceTimelineSemaphoreFeatures timelineFeatures{};
+  timelineFeatures.sType =
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+  timelineFeatures.timelineSemaphore = VK_TRUE;
+
+  const void *featureChain = nullptr;
+  if (dynamicRenderingEnabled) {
+    dynamicRenderingFeatures.pNext = const_cast<void *>(featureChain);
+    featureChain = &dynamicRenderingFeatures;
+  }
+  if (timelineSemaphoreSupported) {
+    timelineFeatures.pNext = const_cast<void *>(featureChain);
+    featureChain = &timelineFeatures;
+  }
+  createInfo.pNext = featureChain;
+
   createInfo.enabledExtensionCount =
       static_cast<uint32_t>(deviceExtensions.size());
   createInfo.ppEnabledExtensionNames = deviceExtensions.data();
@@ -172,13 +351,35 @@ void LveDevice::createLogicalDevice() {
     createInfo.enabledLayerCount = 0;
   }
 
-  if (vkCreateDevice(physicalDevice, &createInfo, nullptr, &device_) !=
+  if (vkCreateDevice(physicalDevice, &createInfo, allocator(), &device_) !=
       VK_SUCCESS) {
     throw std::runtime_error("failed to create logical device!");
   }
 
+  if (dynamicRenderingEnabled) {
+    // loaded per device so neither path depends on the loader's exports
+    pfnCmdBeginRendering = reinterpret_cast<PFN_vkCmdBeginRendering>(
+        vkGetDeviceProcAddr(device_, dynamicRenderingUsesExtension
+                                         ? "vkCmdBeginRenderingKHR"
+                                         : "vkCmdBeginRendering"));
+    pfnCmdEndRendering = reinterpret_cast<PFN_vkCmdEndRendering>(
+        vkGetDeviceProcAddr(device_, dynamicRenderingUsesExtension
+                                         ? "vkCmdEndRenderingKHR"
+                                         : "vkCmdEndRendering"));
+    if (pfnCmdBeginRendering == nullptr || pfnCmdEndRendering == nullptr) {
+      throw std::runtime_error("failed to load dynamic rendering commands!");
+    }
+  }
+
   vkGetDeviceQueue(device_, indices.graphicsFamily, 0, &graphicsQueue_);
   vkGetDeviceQueue(device_, indices.presentFamily, 0, &presentQueue_);
+  vkGetDeviceQueue(device_, indices.transferFamily, indices.transferQueueIndex,
+                   &transferQueue_);
+
+  std::cout << "transfer queue: family " << indices.transferFamily
+            << ", index " << indices.transferQueueIndex
+            << (hasSeparateTransferQueue() ? "" : " (shared with graphics)")
+            << std::endl;
 }
 
 void LveDevice::createCommandPool() {
@@ -190,14 +391,187 @@ void LveDevice::createCommandPool() {
   poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT |
                    VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
 
-  if (vkCreateCommandPool(device_, &poolInfo, nullptr, &commandPool) !=
+  if (vkCreateCommandPool(device_, &poolInfo, allocator(), &commandPool) !=
       VK_SUCCESS) {
     throw std::runtime_error("failed to create command pool!");
   }
 }
 
+void LveDevice::createTransferCommandPool() {
+  VkCommandPoolCreateInfo poolInfo = {};
+  poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+  poolInfo.queueFamilyIndex = queueFamilyIndices.transferFamily;
+  poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT |
+                   VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+
+  if (vkCreateCommandPool(device_, &poolInfo, allocator(),
+                          &transferCommandPool) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create transfer command pool!");
+  }
+}
+
+// Prepended to the vulkan cache data. The driver version is not part of the
+// vulkan header, and the hash catches truncated or corrupted files.
+struct PipelineCacheFileHeader {
+  uint32_t magic;
+  uint32_t vendorID;
+  uint32_t deviceID;
+  uint32_t driverVersion;
+  uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+  uint64_t dataSize;
+  uint64_t dataHash;
+};
+
+static constexpr uint32_t PIPELINE_CACHE_MAGIC = 0x4350564c; // "LVPC"
+
+// FNV-1a
+static uint64_t hashPipelineCacheData(const char *data, size_t size) {
+  uint64_t hash = 0xcbf29ce484222325ull;
+  for (size_t i = 0; i < size; i++) {
+    hash ^= static_cast<uint8_t>(data[i]);
+    hash *= 0x100000001b3ull;
+  }
+  return hash;
+}
+
+// returns why the cache file can't be used, empty when it can
+static std::string
+validatePipelineCache(const PipelineCacheFileHeader &header,
+                      const std::vector<char> &cacheData,
+                      const VkPhysicalDeviceProperties &properties) {
+  if (header.magic != PIPELINE_CACHE_MAGIC ||
+      header.dataSize != cacheData.size() ||
+      header.dataHash !=
+          hashPipelineCacheData(cacheData.data(), cacheData.size())) {
+    return "corrupt file";
+  }
+  if (header.vendorID != properties.vendorID ||
+      header.deviceID != properties.deviceID ||
+      memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID,
+             VK_UUID_SIZE) != 0) {
+    return "different device";
+  }
+  if (header.driverVersion != properties.driverVersion) {
+    return "different driver version";
+  }
+
+  // the vulkan header: size, version, vendor, device, uuid
+  const size_t vulkanHeaderSize = 16 + VK_UUID_SIZE;
+  uint32_t vulkanHeader[4];
+  if (cacheData.size() < vulkanHeaderSize) {
+    return "invalid vulkan cache header";
+  }
+  memcpy(vulkanHeader, cacheData.data(), sizeof(vulkanHeader));
+  if (vulkanHeader[0] < vulkanHeaderSize ||
+      vulkanHeader[1] != VK_PIPELINE_CACHE_HEADER_VERSION_ONE ||
+      vulkanHeader[2] != properties.vendorID ||
+      vulkanHeader[3] != properties.deviceID ||
+      memcmp(cacheData.data() + 16, properties.pipelineCacheUUID,
+             VK_UUID_SIZE) != 0) {
+    return "invalid vulkan cache header";
+  }
+  return "";
+}
+
+void LveDevice::createPipelineCache() {
+  LveStartupProfiler::Scope profile{"LveDevice::createPipelineCache"};
+  std::vector<char> cacheData;
+  std::string rejectReason;
+
+  std::ifstream file{pipelineCachePath, std::ios::ate | std::ios::binary};
+  PipelineCacheFileHeader header{};
+  if (!file.is_open()) {
+    rejectReason = "no cache file";
+  } else {
+    size_t fileSize = static_cast<size_t>(file.tellg());
+    file.seekg(0);
+    if (fileSize < sizeof(header)) {
+      rejectReason = "file too small";
+    } else {
+      file.read(reinterpret_cast<char *>(&header), sizeof(header));
+      cacheData.resize(fileSize - sizeof(header));
+      file.read(cacheData.data(), cacheData.size());
+      rejectReason = validatePipelineCache(header, cacheData, properties);
+    }
+  }
+
+  if (!rejectReason.empty()) {
+    cacheData.clear();
+  }
+  pipelineCacheWarm = !cacheData.empty();
+
+  VkPipelineCacheCreateInfo cacheInfo{};
+  cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+  cacheInfo.initialDataSize = cacheData.size();
+  cacheInfo.pInitialData = cacheData.empty() ? nullptr : cacheData.data();
+
+  if (vkCreatePipelineCache(device_, &cacheInfo, allocator(),
+                            &pipelineCache_) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create pipeline cache!");
+  }
+
+  if (pipelineCacheWarm) {
+    std::cout << "pipeline cache: loaded " << cacheData.size()
+              << " bytes from " << pipelineCachePath << std::endl;
+  } else {
+    std::cout << "pipeline cache: starting cold (" << rejectReason << ")"
+              << std::endl;
+  }
+}
+
+void LveDevice::savePipelineCache() {
+  size_t dataSize = 0;
+  if (vkGetPipelineCacheData(device_, pipelineCache_, &dataSize, nullptr) !=
+          VK_SUCCESS ||
+      dataSize == 0) {
+    return;
+  }
+  std::vector<char> cacheData(dataSize);
+  if (vkGetPipelineCacheData(device_, pipelineCache_, &dataSize,
+                             cacheData.data()) != VK_SUCCESS) {
+    std::cerr << "pipeline cache: failed to read cache data" << std::endl;
+    return;
+  }
+  cacheData.resize(dataSize);
+
+  PipelineCacheFileHeader header{};
+  header.magic = PIPELINE_CACHE_MAGIC;
+  header.vendorID = properties.vendorID;
+  header.deviceID = properties.deviceID;
+  header.driverVersion = properties.driverVersion;
+  memcpy(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE);
+  header.dataSize = cacheData.size();
+  header.dataHash = hashPipelineCacheData(cacheData.data(), cacheData.size());
+
+  // written next to the old file and renamed over it, so a crash mid-write
+  // never leaves a truncated cache behind
+  std::string tempPath = pipelineCachePath + ".tmp";
+  {
+    std::ofstream file{tempPath, std::ios::binary | std::ios::trunc};
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(cacheData.data(), cacheData.size());
+    file.flush();
+    if (!file) {
+      std::cerr << "pipeline cache: failed to write " << tempPath << std::endl;
+      std::remove(tempPath.c_str());
+      return;
+    }
+  }
+  if (std::rename(tempPath.c_str(), pipelineCachePath.c_str()) != 0) {
+    std::cerr << "pipeline cache: failed to replace " << pipelineCachePath
+              << std::endl;
+    std::remove(tempPath.c_str());
+    return;
+  }
+  std::cout << "pipeline cache: saved " << cacheData.size() << " bytes to "
+            << pipelineCachePath << std::endl;
+}
+
 void LveDevice::createSurface() {
-  window.createWindowSurface(instance, &surface_);
+  if (isHeadless()) {
+    return;
+  }
+  window.createWindowSurface(instance, allocator(), &surface_);
 }
 
 bool LveDevice::isDeviceSuitable(VkPhysicalDevice device) {
@@ -205,8 +579,9 @@ bool LveDevice::isDeviceSuitable(VkPhysicalDevice device) {
 
   bool extensionsSupported = checkDeviceExtensionSupport(device);
 
-  bool swapChainAdequate = false;
-  if (extensionsSupported) {
+  // headless rendering never presents, any graphics capable device will do
+  bool swapChainAdequate = isHeadless();
+  if (extensionsSupported && !isHeadless()) {
     SwapChainSupportDetails swapChainSupport = querySwapChainSupport(device);
     swapChainAdequate = !swapChainSupport.formats.empty() &&
                         !swapChainSupport.presentModes.empty();
@@ -237,7 +612,7 @@ void LveDevice::setupDebugMessenger() {
     return;
   VkDebugUtilsMessengerCreateInfoEXT createInfo;
   populateDebugMessengerCreateInfo(createInfo);
-  if (CreateDebugUtilsMessengerEXT(instance, &createInfo, nullptr,
+  if (CreateDebugUtilsMessengerEXT(instance, &createInfo, allocator(),
                                    &debugMessenger) != VK_SUCCESS) {
     throw std::runtime_error("failed to set up debug messenger!");
   }
@@ -269,12 +644,13 @@ bool LveDevice::checkValidationLayerSupport() {
 }
 
 std::vector<const char *> LveDevice::getRequiredExtensions() {
-  uint32_t glfwExtensionCount = 0;
-  const char **glfwExtensions;
-  glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
-
-  std::vector<const char *> extensions(glfwExtensions,
-                                       glfwExtensions + glfwExtensionCount);
+  std::vector<const char *> extensions;
+  if (!isHeadless()) {
+    uint32_t glfwExtensionCount = 0;
+    const char **glfwExtensions;
+    glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+    extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+  }
 
   if (enableValidationLayers) {
     extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
@@ -344,7 +720,14 @@ QueueFamilyIndices LveDevice::findQueueFamilies(VkPhysicalDevice device) {
       indices.graphicsFamilyHasValue = true;
     }
     VkBool32 presentSupport = false;
-    vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface_, &presentSupport);
+    if (isHeadless()) {
+      // nothing is presented, the graphics queue stands in for present
+      presentSupport = indices.graphicsFamilyHasValue &&
+                       indices.graphicsFamily == static_cast<uint32_t>(i);
+    } else {
+      vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface_,
+                                           &presentSupport);
+    }
     if (queueFamily.queueCount > 0 && presentSupport) {
       indices.presentFamily = i;
       indices.presentFamilyHasValue = true;
@@ -359,6 +742,47 @@ QueueFamilyIndices LveDevice::findQueueFamilies(VkPhysicalDevice device) {
   return indices;
 }
 
+void LveDevice::findTransferQueue(VkPhysicalDevice device,
+                                  QueueFamilyIndices &indices) {
+  uint32_t queueFamilyCount = 0;
+  vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, nullptr);
+
+  std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+  vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount,
+                                           queueFamilies.data());
+
+  // prefer a transfer-only family, which is usually a dedicated DMA engine
+  for (uint32_t i = 0; i < queueFamilyCount; i++) {
+    VkQueueFlags flags = queueFamilies[i].queueFlags;
+    if (queueFamilies[i].queueCount > 0 && (flags & VK_QUEUE_TRANSFER_BIT) &&
+        !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT))) {
+      indices.transferFamily = i;
+      indices.transferFamilyHasValue = true;
+      return;
+    }
+  }
+
+  // then any other family, graphics and compute queues implicitly support
+  // transfer operations
+  for (uint32_t i = 0; i < queueFamilyCount; i++) {
+    VkQueueFlags flags = queueFamilies[i].queueFlags;
+    if (i != indices.graphicsFamily && queueFamilies[i].queueCount > 0 &&
+        (flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT |
+                  VK_QUEUE_TRANSFER_BIT))) {
+      indices.transferFamily = i;
+      indices.transferFamilyHasValue = true;
+      return;
+    }
+  }
+
+  // single family: use a second queue of it if there is one, otherwise share
+  // the graphics queue and rely on submission order
+  indices.transferFamily = indices.graphicsFamily;
+  indices.transferFamilyHasValue = true;
+  indices.transferQueueIndex =
+      queueFamilies[indices.graphicsFamily].queueCount > 1 ? 1 : 0;
+}
+
 SwapChainSupportDetails
 LveDevice::querySwapChainSupport(VkPhysicalDevice device) {
   SwapChainSupportDetails details;
@@ -404,13 +828,22 @@ VkFormat LveDevice::findSupportedFormat(const std::vector<VkFormat> &candidates,
   throw std::runtime_error("failed to find supported format!");
 }
 
+bool LveDevice::supportsFormatFeatures(VkFormat format, VkImageTiling tiling,
+                                       VkFormatFeatureFlags features) {
+  VkFormatProperties props;
+  vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &props);
+  VkFormatFeatureFlags supported = tiling == VK_IMAGE_TILING_LINEAR
+                                       ? props.linearTilingFeatures
+                                       : props.optimalTilingFeatures;
+  return (supported & features) == features;
+}
+
 uint32_t LveDevice::findMemoryType(uint32_t typeFilter,
                                    VkMemoryPropertyFlags properties) {
-  VkPhysicalDeviceMemoryProperties memProperties;
-  vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
-  for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
-    if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags &
-                                    properties) == properties) {
+  for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
+    if ((typeFilter & (1 << i)) &&
+        (memoryProperties.memoryTypes[i].propertyFlags & properties) ==
+            properties) {
       return i;
     }
   }
@@ -427,7 +860,18 @@ void LveDevice::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage,
   bufferInfo.usage = usage;
   bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
-  if (vkCreateBuffer(device_, &bufferInfo, nullptr, &buffer) != VK_SUCCESS) {
+  // buffers filled by the transfer queue are read by the graphics queue
+  uint32_t queueFamilies[] = {queueFamilyIndices.graphicsFamily,
+                              queueFamilyIndices.transferFamily};
+  if ((usage & VK_BUFFER_USAGE_TRANSFER_DST_BIT) &&
+      queueFamilies[0] != queueFamilies[1]) {
+    bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+    bufferInfo.queueFamilyIndexCount = 2;
+    bufferInfo.pQueueFamilyIndices = queueFamilies;
+  }
+
+  if (vkCreateBuffer(device_, &bufferInfo, allocator(), &buffer) !=
+      VK_SUCCESS) {
     throw std::runtime_error("failed to create vertex buffer!");
   }
 
@@ -440,7 +884,7 @@ void LveDevice::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage,
   allocInfo.memoryTypeIndex =
       findMemoryType(memRequirements.memoryTypeBits, properties);
 
-  if (vkAllocateMemory(device_, &allocInfo, nullptr, &bufferMemory) !=
+  if (vkAllocateMemory(device_, &allocInfo, allocator(), &bufferMemory) !=
       VK_SUCCESS) {
     throw std::runtime_error("failed to allocate vertex buffer memory!");
   }
@@ -516,11 +960,166 @@ void LveDevice::copyBufferToImage(VkBuffer buffer, VkImage image,
   endSingleTimeCommands(commandBuffer);
 }
 
+VkCommandBuffer LveDevice::beginTransferCommands() {
+  VkCommandBufferAllocateInfo allocInfo{};
+  allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  allocInfo.commandPool = transferCommandPool;
+  allocInfo.commandBufferCount = 1;
+
+  VkCommandBuffer commandBuffer;
+  if (vkAllocateCommandBuffers(device_, &allocInfo, &commandBuffer) !=
+      VK_SUCCESS) {
+    throw std::runtime_error("failed to allocate transfer command buffer!");
+  }
+
+  VkCommandBufferBeginInfo beginInfo{};
+  beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+  vkBeginCommandBuffer(commandBuffer, &beginInfo);
+  return commandBuffer;
+}
+
+void LveDevice::submitTransferCommands(VkCommandBuffer commandBuffer,
+                                       std::function<void()> onComplete) {
+  if (!hasSeparateTransferQueue()) {
+    // same queue as rendering, a barrier orders the copy before any later
+    // read without needing a semaphore
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask =
+        VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT |
+        VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_VERTEX_INPUT_BIT |
+                             VK_PIPELINE_STAGE_VERTEX_SHADER_BIT |
+                             VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                         0, 1, &barrier, 0, nullptr, 0, nullptr);
+  }
+  vkEndCommandBuffer(commandBuffer);
+
+  VkFence fence = acquireTransferFence();
+
+  VkSemaphore semaphore = VK_NULL_HANDLE;
+  if (hasSeparateTransferQueue()) {
+    if (freeTransferSemaphores.empty()) {
+      VkSemaphoreCreateInfo semaphoreInfo{};
+      semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+      if (vkCreateSemaphore(device_, &semaphoreInfo, allocator(), &semaphore) !=
+          VK_SUCCESS) {
+        throw std::runtime_error("failed to create transfer semaphore!");
+      }
+    } else {
+      semaphore = freeTransferSemaphores.back();
+      freeTransferSemaphores.pop_back();
+    }
+  }
+
+  VkSubmitInfo submitInfo{};
+  submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  submitInfo.commandBufferCount = 1;
+  submitInfo.pCommandBuffers = &commandBuffer;
+  if (semaphore != VK_NULL_HANDLE) {
+    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pSignalSemaphores = &semaphore;
+  }
+
+  if (vkQueueSubmit(transferQueue_, 1, &submitInfo, fence) != VK_SUCCESS) {
+    throw std::runtime_error("failed to submit transfer command buffer!");
+  }
+
+  if (semaphore != VK_NULL_HANDLE) {
+    signaledTransferSemaphores.push_back(semaphore);
+  }
+  pendingTransfers.push_back(
+      {commandBuffer, transferCommandPool, fence, std::move(onComplete)});
+}
+
+void LveDevice::submitGraphicsCommands(VkCommandBuffer commandBuffer,
+                                       std::function<void()> onComplete) {
+  vkEndCommandBuffer(commandBuffer);
+
+  VkFence fence = acquireTransferFence();
+
+  VkSubmitInfo submitInfo{};
+  submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  submitInfo.commandBufferCount = 1;
+  submitInfo.pCommandBuffers = &commandBuffer;
+
+  if (vkQueueSubmit(graphicsQueue_, 1, &submitInfo, fence) != VK_SUCCESS) {
+    throw std::runtime_error("failed to submit graphics command buffer!");
+  }
+
+  pendingTransfers.push_back(
+      {commandBuffer, commandPool, fence, std::move(onComplete)});
+}
+
+VkFence LveDevice::acquireTransferFence() {
+  if (!freeTransferFences.empty()) {
+    VkFence fence = freeTransferFences.back();
+    freeTransferFences.pop_back();
+    return fence;
+  }
+
+  VkFenceCreateInfo fenceInfo{};
+  fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+  VkFence fence;
+  if (vkCreateFence(device_, &fenceInfo, allocator(), &fence) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create transfer fence!");
+  }
+  return fence;
+}
+
+void LveDevice::copyBufferAsync(VkBuffer srcBuffer, VkBuffer dstBuffer,
+                                VkDeviceSize size,
+                                std::function<void()> onComplete) {
+  VkCommandBuffer commandBuffer = beginTransferCommands();
+
+  VkBufferCopy copyRegion{};
+  copyRegion.size = size;
+  vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
+
+  submitTransferCommands(commandBuffer, std::move(onComplete));
+}
+
+void LveDevice::retireTransfers() {
+  auto it = pendingTransfers.begin();
+  while (it != pendingTransfers.end()) {
+    if (vkGetFenceStatus(device_, it->fence) != VK_SUCCESS) {
+      ++it;
+      continue;
+    }
+
+    if (it->onComplete) {
+      it->onComplete();
+    }
+    vkFreeCommandBuffers(device_, it->commandPool, 1, &it->commandBuffer);
+    vkResetFences(device_, 1, &it->fence);
+    freeTransferFences.push_back(it->fence);
+    it = pendingTransfers.erase(it);
+  }
+}
+
+void LveDevice::takeTransferSemaphores(std::vector<VkSemaphore> &semaphores) {
+  semaphores.insert(semaphores.end(), signaledTransferSemaphores.begin(),
+                    signaledTransferSemaphores.end());
+  signaledTransferSemaphores.clear();
+}
+
+void LveDevice::recycleTransferSemaphores(
+    std::vector<VkSemaphore> &semaphores) {
+  freeTransferSemaphores.insert(freeTransferSemaphores.end(),
+                                semaphores.begin(), semaphores.end());
+  semaphores.clear();
+}
+
 void LveDevice::createImageWithInfo(const VkImageCreateInfo &imageInfo,
                                     VkMemoryPropertyFlags properties,
                                     VkImage &image,
                                     VkDeviceMemory &imageMemory) {
-  if (vkCreateImage(device_, &imageInfo, nullptr, &image) != VK_SUCCESS) {
+  if (vkCreateImage(device_, &imageInfo, allocator(), &image) != VK_SUCCESS) {
     throw std::runtime_error("failed to create image!");
   }
 
@@ -533,7 +1132,7 @@ void LveDevice::createImageWithInfo(const VkImageCreateInfo &imageInfo,
   allocInfo.memoryTypeIndex =
       findMemoryType(memRequirements.memoryTypeBits, properties);
 
-  if (vkAllocateMemory(device_, &allocInfo, nullptr, &imageMemory) !=
+  if (vkAllocateMemory(device_, &allocInfo, allocator(), &imageMemory) !=
       VK_SUCCESS) {
     throw std::runtime_error("failed to allocate image memory!");
   }
@@ -543,4 +1142,104 @@ void LveDevice::createImageWithInfo(const VkImageCreateInfo &imageInfo,
   }
 }
 
+void LveDevice::deferDestruction(std::function<void()> deleter) {
+  std::lock_guard<std::mutex> lock{deletionMutex};
+  deletionQueue.emplace_back(frameSerial.load(), std::move(deleter));
+}
+
+void LveDevice::destroyImageDeferred(VkImage image, VkImageView imageView,
+                                     VkDeviceMemory imageMemory) {
+  VkDevice device = device_;
+  const VkAllocationCallbacks *allocator = this->allocator();
+  deferDestruction([device, image, imageView, imageMemory, allocator]() {
+    vkDestroyImageView(device, imageView, allocator);
+    vkDestroyImage(device, image, allocator);
+    vkFreeMemory(device, imageMemory, allocator);
+  });
+}
+
+void LveDevice::markFrameCompleted(uint64_t serial) {
+  uint64_t completed = lastCompletedFrameSerial.load();
+  while (serial > completed &&
+         !lastCompletedFrameSerial.compare_exchange_weak(completed, serial)) {
+  }
+  runDeleters(lastCompletedFrameSerial.load());
+}
+
+void LveDevice::runDeleters(uint64_t completedSerial) {
+  while (true) {
+    std::function<void()> deleter;
+    {
+      std::lock_guard<std::mutex> lock{deletionMutex};
+      if (deletionQueue.empty() ||
+          deletionQueue.front().first > completedSerial) {
+        return;
+      }
+      deleter = std::move(deletionQueue.front().second);
+      deletionQueue.pop_front();
+    }
+    deleter();
+  }
+}
+
+void LveDevice::createFrameTimeline() {
+  if (!timelineSemaphoreSupported) {
+    return;
+  }
+
+  // starts at the last completed serial, frame N signals N
+  VkSemaphoreTypeCreateInfo typeInfo{};
+  typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+  typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+  typeInfo.initialValue = lastCompletedFrameSerial.load();
+
+  VkSemaphoreCreateInfo semaphoreInfo{};
+  semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+  semaphoreInfo.pNext = &typeInfo;
+
+  if (vkCreateSemaphore(device_, &semaphoreInfo, allocator(), &frameTimeline) !=
+      VK_SUCCESS) {
+    throw std::runtime_error("failed to create frame timeline semaphore!");
+  }
+}
+
+bool LveDevice::isFrameComplete(uint64_t serial) {
+  if (serial <= lastCompletedFrameSerial) {
+    return true;
+  }
+  if (frameTimeline == VK_NULL_HANDLE) {
+    return false;
+  }
+  uint64_t value = 0;
+  vkGetSemaphoreCounterValue(device_, frameTimeline, &value);
+  return value >= serial;
+}
+
+void LveDevice::waitForFrame(uint64_t serial) {
+  if (serial <= lastCompletedFrameSerial) {
+    return;
+  }
+  if (frameTimeline == VK_NULL_HANDLE) {
+    waitIdle();
+    return;
+  }
+
+  VkSemaphoreWaitInfo waitInfo{};
+  waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+  waitInfo.semaphoreCount = 1;
+  waitInfo.pSemaphores = &frameTimeline;
+  waitInfo.pValues = &serial;
+  if (vkWaitSemaphores(device_, &waitInfo,
+                       std::numeric_limits<uint64_t>::max()) != VK_SUCCESS) {
+    throw std::runtime_error("failed to wait for frame timeline!");
+  }
+  markFrameCompleted(serial);
+}
+
+void LveDevice::waitIdle() {
+  vkDeviceWaitIdle(device_);
+  retireTransfers();
+  markFrameCompleted(frameSerial - 1);
+}
+
 } // namespace lve
@@ -1,8 +1,13 @@
 #pragma once
 
+#include "lve_allocator.hpp"
 #include "lve_window.hpp"
 
 // std lib headers
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -17,11 +22,21 @@ struct SwapChainSupportDetails {
 struct QueueFamilyIndices {
   uint32_t graphicsFamily;
   uint32_t presentFamily;
+  uint32_t transferFamily;
+  uint32_t transferQueueIndex = 0;
   bool graphicsFamilyHasValue = false;
   bool presentFamilyHasValue = false;
+  bool transferFamilyHasValue = false;
   bool isComplete() { return graphicsFamilyHasValue && presentFamilyHasValue; }
 };
 
+// optional features, each falls back to the 1.0 path when unsupported
+struct LveDeviceFeatures {
+  bool dynamicRendering = false;
+  bool timelineSemaphore = false;
+  bool pipelineStatistics = false;
+};
+
 class LveDevice {
 public:
 #ifdef NDEBUG
@@ -30,7 +45,7 @@ public:
   const bool enableValidationLayers = true;
 #endif
 
-  LveDevice(LveWindow &window);
+  LveDevice(LveWindow &window, LveDeviceFeatures requested = {});
   ~LveDevice();
 
   // Not copyable or movable
@@ -42,20 +57,35 @@ public:
   VkCommandPool getCommandPool() { return commandPool; }
   VkDevice device() { return device_; }
   VkSurfaceKHR surface() { return surface_; }
+  // headless devices have no surface and never present
+  bool isHeadless() const { return window.isHeadless(); }
   VkQueue graphicsQueue() { return graphicsQueue_; }
   VkQueue presentQueue() { return presentQueue_; }
+  VkQueue transferQueue() { return transferQueue_; }
+  // shared by all pipeline creation, persisted across runs
+  VkPipelineCache pipelineCache() { return pipelineCache_; }
+  bool isPipelineCacheWarm() const { return pipelineCacheWarm; }
+  // passed to every vkCreate*/vkDestroy* call so host memory is accounted
+  const VkAllocationCallbacks *allocator() const {
+    return hostAllocator.callbacks();
+  }
+  LveAllocator &getHostAllocator() { return hostAllocator; }
+
+  // true when uploads run on a queue other than the graphics queue and have
+  // to be synchronized with a semaphore
+  bool hasSeparateTransferQueue() { return transferQueue_ != graphicsQueue_; }
 
   SwapChainSupportDetails getSwapChainSupport() {
     return querySwapChainSupport(physicalDevice);
   }
   uint32_t findMemoryType(uint32_t typeFilter,
                           VkMemoryPropertyFlags properties);
-  QueueFamilyIndices findPhysicalQueueFamilies() {
-    return findQueueFamilies(physicalDevice);
-  }
+  QueueFamilyIndices findPhysicalQueueFamilies() { return queueFamilyIndices; }
   VkFormat findSupportedFormat(const std::vector<VkFormat> &candidates,
                                VkImageTiling tiling,
                                VkFormatFeatureFlags features);
+  bool supportsFormatFeatures(VkFormat format, VkImageTiling tiling,
+                              VkFormatFeatureFlags features);
 
   // Buffer Helper Functions
   void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage,
@@ -67,45 +97,158 @@ public:
   void copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width,
                          uint32_t height, uint32_t layerCount);
 
+  // Asynchronous uploads on the transfer queue. onComplete runs on the main
+  // thread from retireTransfers() once the copy has finished, which is where
+  // staging memory should be released.
+  VkCommandBuffer beginTransferCommands();
+  void submitTransferCommands(VkCommandBuffer commandBuffer,
+                              std::function<void()> onComplete = nullptr);
+  void copyBufferAsync(VkBuffer srcBuffer, VkBuffer dstBuffer,
+                       VkDeviceSize size,
+                       std::function<void()> onComplete = nullptr);
+  void retireTransfers();
+
+  // Asynchronous counterpart of endSingleTimeCommands for work that needs the
+  // graphics queue (blits, layout transitions). Completion is reported through
+  // retireTransfers like uploads.
+  void submitGraphicsCommands(VkCommandBuffer commandBuffer,
+                              std::function<void()> onComplete = nullptr);
+
+  // Semaphores signalled by uploads that the next graphics submission has to
+  // wait on. The caller hands them back with recycleTransferSemaphores once
+  // the submission that waited on them has completed.
+  void takeTransferSemaphores(std::vector<VkSemaphore> &semaphores);
+  void recycleTransferSemaphores(std::vector<VkSemaphore> &semaphores);
+
   void createImageWithInfo(const VkImageCreateInfo &imageInfo,
                            VkMemoryPropertyFlags properties, VkImage &image,
                            VkDeviceMemory &imageMemory);
 
+  // Frame-fenced deferred destruction. Anything queued while frame N is
+  // being recorded is destroyed once the GPU has finished frame N, so GPU
+  // resources can be released from the frame loop without vkDeviceWaitIdle.
+  // Safe to call from any thread, the deleters run on the thread that
+  // retires the frame.
+  void deferDestruction(std::function<void()> deleter);
+  void destroyImageDeferred(VkImage image, VkImageView imageView,
+                            VkDeviceMemory imageMemory);
+
+  // The swap chain reports frame submission and completion from the render
+  // thread. Serials start at 1, the current serial is the frame being
+  // recorded, both serials can be read from any thread.
+  uint64_t currentFrameSerial() const { return frameSerial; }
+  uint64_t completedFrameSerial() const { return lastCompletedFrameSerial; }
+  uint64_t submitFrame() { return frameSerial++; }
+  void markFrameCompleted(uint64_t serial);
+  void waitIdle();
+
+  // With timeline semaphores every frame submission signals frameTimeline
+  // with its serial, so completion can be checked from any thread without
+  // fence handles. Without them isFrameComplete only sees what the swap
+  // chain has reported.
+  bool useTimelineSemaphore() const { return frameTimeline != VK_NULL_HANDLE; }
+  VkSemaphore frameTimelineSemaphore() { return frameTimeline; }
+  bool supportsPipelineStatistics() const {
+    return pipelineStatisticsEnabled;
+  }
+  bool isFrameComplete(uint64_t serial);
+  // Blocks until the frame is done and runs its deferred deleters. Render
+  // thread only, without timeline semaphores it waits for the device to idle.
+  void waitForFrame(uint64_t serial);
+
+  // true when rendering goes through vkCmdBeginRendering instead of render
+  // pass and framebuffer objects, either core 1.3 or VK_KHR_dynamic_rendering
+  bool useDynamicRendering() const { return dynamicRenderingEnabled; }
+  void cmdBeginRendering(VkCommandBuffer commandBuffer,
+                         const VkRenderingInfo *renderingInfo) {
+    pfnCmdBeginRendering(commandBuffer, renderingInfo);
+  }
+  void cmdEndRendering(VkCommandBuffer commandBuffer) {
+    pfnCmdEndRendering(commandBuffer);
+  }
+
   VkPhysicalDeviceProperties properties;
+  VkPhysicalDeviceMemoryProperties memoryProperties;
+  // 0 when the graphics queue does not support timestamp queries
+  uint32_t graphicsTimestampValidBits = 0;
 
 private:
   void createInstance();
   void setupDebugMessenger();
   void createSurface();
   void pickPhysicalDevice();
+  void queryOptionalFeatures();
+  void createFrameTimeline();
+  // in queue order, up to the first one queued after completedSerial
+  void runDeleters(uint64_t completedSerial);
   void createLogicalDevice();
   void createCommandPool();
+  void createTransferCommandPool();
+  void createPipelineCache();
+  void savePipelineCache();
 
   // helper functions
   bool isDeviceSuitable(VkPhysicalDevice device);
   std::vector<const char *> getRequiredExtensions();
   bool checkValidationLayerSupport();
   QueueFamilyIndices findQueueFamilies(VkPhysicalDevice device);
+  void findTransferQueue(VkPhysicalDevice device, QueueFamilyIndices &indices);
+  VkFence acquireTransferFence();
   void populateDebugMessengerCreateInfo(
       VkDebugUtilsMessengerCreateInfoEXT &createInfo);
   void hasGflwRequiredInstanceExtensions();
   bool checkDeviceExtensionSupport(VkPhysicalDevice device);
   SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device);
 
+  // declared first so it outlives every object created with it
+  LveAllocator hostAllocator;
   VkInstance instance;
   VkDebugUtilsMessengerEXT debugMessenger;
   VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
   LveWindow &window;
+  LveDeviceFeatures requestedFeatures;
+  bool timelineSemaphoreSupported = false;
+  bool pipelineStatisticsEnabled = false;
+  VkSemaphore frameTimeline = VK_NULL_HANDLE;
+  bool dynamicRenderingEnabled = false;
+  bool dynamicRenderingUsesExtension = false;
+  uint32_t instanceApiVersion = VK_API_VERSION_1_0;
+  PFN_vkCmdBeginRendering pfnCmdBeginRendering = nullptr;
+  PFN_vkCmdEndRendering pfnCmdEndRendering = nullptr;
   VkCommandPool commandPool;
+  VkCommandPool transferCommandPool;
+  QueueFamilyIndices queueFamilyIndices;
 
   VkDevice device_;
-  VkSurfaceKHR surface_;
+  VkSurfaceKHR surface_ = VK_NULL_HANDLE;
   VkQueue graphicsQueue_;
   VkQueue presentQueue_;
+  VkQueue transferQueue_;
+  VkPipelineCache pipelineCache_;
+  bool pipelineCacheWarm = false;
+
+  struct PendingTransfer {
+    VkCommandBuffer commandBuffer;
+    VkCommandPool commandPool;
+    VkFence fence;
+    std::function<void()> onComplete;
+  };
+  std::vector<PendingTransfer> pendingTransfers;
+  std::vector<VkFence> freeTransferFences;
+  std::vector<VkSemaphore> signaledTransferSemaphores;
+  std::vector<VkSemaphore> freeTransferSemaphores;
+
+  std::atomic<uint64_t> frameSerial{1};
+  std::atomic<uint64_t> lastCompletedFrameSerial{0};
+  // deleters are run outside the lock, they may queue more
+  std::mutex deletionMutex;
+  std::deque<std::pair<uint64_t, std::function<void()>>> deletionQueue;
+
+  const std::string pipelineCachePath = "pipeline_cache.bin";
 
   const std::vector<const char *> validationLayers = {
       "VK_LAYER_KHRONOS_validation"};
-  const std::vector<const char *> deviceExtensions = {
+  std::vector<const char *> deviceExtensions = {
       VK_KHR_SWAPCHAIN_EXTENSION_NAME};
 };
 
@@ -0,0 +1,107 @@
+#include "lve_dynamic_resolution.hpp"
+
+// std
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+
+namespace lve {
+
+LveDynamicResolution::LveDynamicResolution(const Settings &settings) {
+  setSettings(settings);
+}
+
+void LveDynamicResolution::setSettings(const Settings &settings) {
+  this->settings = settings;
+  this->settings.minScale = std::clamp(settings.minScale, 0.1f, 1.0f);
+  this->settings.maxScale =
+      std::clamp(settings.maxScale, this->settings.minScale, 1.0f);
+  restart();
+}
+
+void LveDynamicResolution::restart() {
+  state = State{};
+  state.requestedScale = settings.maxScale;
+  if (!fixed) {
+    scale = settings.maxScale;
+  }
+  scaleStats.clear();
+}
+
+void LveDynamicResolution::update(double gpuMs) {
+  state.gpuMs = gpuMs;
+  scaleStats.add(scale);
+  if (fixed || gpuMs <= 0.0) {
+    return;
+  }
+  // the frames measured next were recorded before the last change
+  if (state.framesUntilSettled > 0) {
+    state.framesUntilSettled--;
+    return;
+  }
+
+  double error = (settings.targetGpuMs - gpuMs) / settings.targetGpuMs;
+  double derivative = error - state.error;
+  // inside the deadband the scale holds while the error terms keep up, so
+  // leaving it does not kick the output
+  double delta = 0.0;
+  if (std::abs(error) >= settings.deadband) {
+    delta = settings.proportionalGain * derivative +
+            settings.integralGain * error +
+            settings.derivativeGain * (derivative - state.derivative);
+  }
+  state.error = error;
+  state.derivative = derivative;
+
+  float requested = std::clamp(
+      static_cast<float>(state.requestedScale + delta), settings.minScale,
+      settings.maxScale);
+  state.requestedScale = requested;
+
+  bool atLimit =
+      requested == settings.minScale || requested == settings.maxScale;
+  if (requested != scale &&
+      (std::abs(requested - scale) >= settings.minStep || atLimit)) {
+    scale = requested;
+    state.framesUntilSettled = settings.settleFrames;
+    state.changes++;
+  }
+}
+
+void LveDynamicResolution::setFixedScale(float scale) {
+  fixed = true;
+  this->scale = std::clamp(scale, 0.1f, 1.0f);
+  scaleStats.clear();
+}
+
+void LveDynamicResolution::clearFixedScale() {
+  fixed = false;
+  restart();
+}
+
+VkExtent2D LveDynamicResolution::scaleExtent(VkExtent2D extent) const {
+  auto scaled = [this](uint32_t size) {
+    return std::max(1u, static_cast<uint32_t>(std::lround(size * scale)));
+  };
+  return {scaled(extent.width), scaled(extent.height)};
+}
+
+void LveDynamicResolution::printStats(VkExtent2D extent) const {
+  VkExtent2D scaled = scaleExtent(extent);
+  std::cout << std::fixed << std::setprecision(2);
+  std::cout << "dynamic resolution: scale " << scale << " (" << scaled.width
+            << "x" << scaled.height << ")";
+  if (fixed) {
+    std::cout << " fixed";
+  } else if (scaleStats.count() > 0) {
+    std::cout << ", " << scaleStats.min() << " to " << scaleStats.max()
+              << " over " << scaleStats.count() << " frames, gpu "
+              << state.gpuMs << " ms of " << settings.targetGpuMs
+              << " ms target, error " << state.error << ", "
+              << state.changes << " changes";
+  }
+  std::cout << std::endl << std::defaultfloat;
+}
+
+} // namespace lve
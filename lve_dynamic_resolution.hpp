@@ -0,0 +1,81 @@
+#pragma once
+
+#include "lve_stats.hpp"
+
+// std
+#include <cstdint>
+#include <vulkan/vulkan_core.h>
+
+namespace lve {
+
+// Picks the fraction of the swap chain extent the scene renders at from
+// measured GPU frame time. A PID controller in velocity form moves the scale
+// towards the frame time target, which keeps it from winding up while the
+// scale sits at a limit. Errors inside the deadband count as on target and
+// output changes smaller than minStep are held back, so timing noise does
+// not resize the scene every frame. After each change the controller waits
+// for the frames already in flight to retire before it measures again.
+class LveDynamicResolution {
+public:
+  struct Settings {
+    double targetGpuMs = 1000.0 / 60.0;
+    float minScale = 0.5f;
+    float maxScale = 1.0f;
+    // gains on the frame time error relative to the target
+    double proportionalGain = 0.2;
+    double integralGain = 0.1;
+    double derivativeGain = 0.05;
+    double deadband = 0.05;
+    float minStep = 0.05f;
+    uint32_t settleFrames = 4;
+  };
+
+  struct State {
+    double gpuMs = 0.0;
+    // positive while there is headroom, relative to the target
+    double error = 0.0;
+    double derivative = 0.0;
+    // what the controller asks for, before the minimum step is applied
+    float requestedScale = 1.0f;
+    uint32_t framesUntilSettled = 0;
+    uint64_t changes = 0;
+  };
+
+  LveDynamicResolution() = default;
+  explicit LveDynamicResolution(const Settings &settings);
+
+  // a new target or range restarts the controller from maxScale
+  void setSettings(const Settings &settings);
+  const Settings &getSettings() const { return settings; }
+  // unlike setSettings keeps the current scale, for a new frame latency
+  void setSettleFrames(uint32_t settleFrames) {
+    settings.settleFrames = settleFrames;
+  }
+  const State &getState() const { return state; }
+
+  // call once per frame with the latest GPU frame time read back
+  void update(double gpuMs);
+
+  // renders at exactly this scale and ignores frame times, for benchmarks
+  void setFixedScale(float scale);
+  void clearFixedScale();
+  bool isFixed() const { return fixed; }
+
+  float getScale() const { return scale; }
+  // extent scaled down, never empty
+  VkExtent2D scaleExtent(VkExtent2D extent) const;
+
+  const LveRollingStats &getScaleStats() const { return scaleStats; }
+  void printStats(VkExtent2D extent) const;
+
+private:
+  void restart();
+
+  Settings settings{};
+  State state{};
+  float scale = 1.0f;
+  bool fixed = false;
+  LveRollingStats scaleStats{};
+};
+
+} // namespace lve
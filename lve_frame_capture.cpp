@@ -0,0 +1,160 @@
+#include "lve_frame_capture.hpp"
+
+// std
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+
+namespace lve {
+
+static uint32_t bytesPerPixel(VkFormat format) {
+  switch (format) {
+  case VK_FORMAT_B8G8R8A8_SRGB:
+  case VK_FORMAT_B8G8R8A8_UNORM:
+  case VK_FORMAT_R8G8B8A8_SRGB:
+  case VK_FORMAT_R8G8B8A8_UNORM:
+    return 4;
+  default:
+    throw std::runtime_error("unsupported frame capture format!");
+  }
+}
+
+LveFrameCapture::LveFrameCapture(LveDevice &device, uint32_t slotCount,
+                                 Callback callback)
+    : lveDevice{device}, callback{std::move(callback)} {
+  // the CPU reads every byte, cached memory avoids uncached reads where the
+  // device offers it
+  memoryFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+  const auto &memoryProperties = lveDevice.memoryProperties;
+  for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
+    VkMemoryPropertyFlags flags = memoryProperties.memoryTypes[i].propertyFlags;
+    if ((flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) &&
+        (flags & VK_MEMORY_PROPERTY_HOST_CACHED_BIT)) {
+      memoryFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                    VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+      break;
+    }
+  }
+  slots.resize(std::max<uint32_t>(slotCount, 1));
+}
+
+void LveFrameCapture::ensureCapacity(Slot &slot, VkDeviceSize size) {
+  if (slot.buffer != nullptr && slot.buffer->getBufferSize() >= size) {
+    return;
+  }
+  // the old buffer is released once the frames using it have retired
+  slot.buffer = std::make_unique<LveBuffer>(
+      lveDevice, size, 1, VK_BUFFER_USAGE_TRANSFER_DST_BIT, memoryFlags);
+  slot.buffer->map();
+}
+
+void LveFrameCapture::record(VkCommandBuffer commandBuffer, VkImage image,
+                             VkExtent2D extent, VkFormat format,
+                             uint64_t frameSerial) {
+  uint64_t frameNumber = offeredCount++;
+  Slot &slot = slots[writeSlot];
+  if (slot.pending) {
+    droppedCount++;
+    return;
+  }
+  VkDeviceSize size = static_cast<VkDeviceSize>(extent.width) *
+                      extent.height * bytesPerPixel(format);
+  ensureCapacity(slot, size);
+
+  // the render pass only orders its writes before the end of the frame, make
+  // them visible to the copy
+  VkImageMemoryBarrier imageBarrier{};
+  imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+  imageBarrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+  imageBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+  imageBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+  imageBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+  imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  imageBarrier.image = image;
+  imageBarrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+  vkCmdPipelineBarrier(commandBuffer,
+                       VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                       VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0,
+                       nullptr, 1, &imageBarrier);
+
+  VkBufferImageCopy region{};
+  region.bufferOffset = 0;
+  region.bufferRowLength = 0;
+  region.bufferImageHeight = 0;
+  region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+  region.imageOffset = {0, 0, 0};
+  region.imageExtent = {extent.width, extent.height, 1};
+  vkCmdCopyImageToBuffer(commandBuffer, image,
+                         VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                         slot.buffer->getBuffer(), 1, &region);
+
+  VkBufferMemoryBarrier bufferBarrier{};
+  bufferBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+  bufferBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  bufferBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+  bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  bufferBarrier.buffer = slot.buffer->getBuffer();
+  bufferBarrier.offset = 0;
+  bufferBarrier.size = size;
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1,
+                       &bufferBarrier, 0, nullptr);
+
+  slot.pending = true;
+  slot.frameSerial = frameSerial;
+  slot.frameNumber = frameNumber;
+  slot.width = extent.width;
+  slot.height = extent.height;
+  slot.format = format;
+  slot.recordTime = std::chrono::steady_clock::now();
+  writeSlot = (writeSlot + 1) % slots.size();
+}
+
+void LveFrameCapture::collect() {
+  while (slots[readSlot].pending &&
+         lveDevice.isFrameComplete(slots[readSlot].frameSerial)) {
+    Slot &slot = slots[readSlot];
+    slot.buffer->invalidate();
+
+    LveCapturedFrame frame{};
+    frame.pixels = slot.buffer->getMappedMemory();
+    frame.width = slot.width;
+    frame.height = slot.height;
+    frame.rowPitch = slot.width * bytesPerPixel(slot.format);
+    frame.format = slot.format;
+    frame.frameNumber = slot.frameNumber;
+    frame.latencyMs = std::chrono::duration<double, std::milli>(
+                          std::chrono::steady_clock::now() - slot.recordTime)
+                          .count();
+    latencyStats.add(frame.latencyMs);
+    capturedCount++;
+    if (callback) {
+      callback(frame);
+    }
+
+    slot.pending = false;
+    readSlot = (readSlot + 1) % slots.size();
+  }
+}
+
+void LveFrameCapture::flush() {
+  while (slots[readSlot].pending) {
+    lveDevice.waitForFrame(slots[readSlot].frameSerial);
+    collect();
+  }
+}
+
+void LveFrameCapture::printStats() const {
+  std::cout << std::fixed << std::setprecision(3);
+  std::cout << "frame capture: " << capturedCount << " captured, "
+            << droppedCount << " dropped, latency avg "
+            << latencyStats.average() << " ms  p99 "
+            << latencyStats.percentile(99) << " ms" << std::endl;
+  std::cout << std::defaultfloat;
+}
+
+} // namespace lve
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "lve_buffer.hpp"
+#include "lve_device.hpp"
+#include "lve_stats.hpp"
+
+// std
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace lve {
+
+struct LveCapturedFrame {
+  const void *pixels;
+  uint32_t width;
+  uint32_t height;
+  // bytes between rows, rows are tightly packed
+  uint32_t rowPitch;
+  VkFormat format;
+  // counts captured frames, gaps mean frames were dropped
+  uint64_t frameNumber;
+  // from the end of recording to delivery
+  double latencyMs;
+};
+
+// Copies rendered frames into a ring of host visible buffers and hands them
+// out once the GPU has finished them. Copies are recorded at the end of a
+// frame and collected after later frames' fence waits, so delivery trails
+// rendering by the number of frames in flight and the CPU never waits on a
+// readback. When every slot is still in flight the frame is not captured.
+class LveFrameCapture {
+public:
+  using Callback = std::function<void(const LveCapturedFrame &)>;
+
+  LveFrameCapture(LveDevice &device, uint32_t slotCount, Callback callback);
+
+  LveFrameCapture(const LveFrameCapture &) = delete;
+  LveFrameCapture &operator=(const LveFrameCapture &) = delete;
+
+  // Records the copy of image, which has to be in TRANSFER_SRC_OPTIMAL after
+  // color attachment writes, for the frame with the given serial.
+  void record(VkCommandBuffer commandBuffer, VkImage image, VkExtent2D extent,
+              VkFormat format, uint64_t frameSerial);
+  // delivers every finished frame in capture order
+  void collect();
+  // waits for the frames still being read back and delivers them, call
+  // before the last frame's results would otherwise be lost
+  void flush();
+
+  uint64_t getCapturedCount() const { return capturedCount; }
+  uint64_t getDroppedCount() const { return droppedCount; }
+  const LveRollingStats &getLatencyStats() const { return latencyStats; }
+  void printStats() const;
+
+private:
+  struct Slot {
+    std::unique_ptr<LveBuffer> buffer;
+    bool pending = false;
+    uint64_t frameSerial = 0;
+    uint64_t frameNumber = 0;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    VkFormat format = VK_FORMAT_UNDEFINED;
+    std::chrono::steady_clock::time_point recordTime;
+  };
+
+  void ensureCapacity(Slot &slot, VkDeviceSize size);
+
+  LveDevice &lveDevice;
+  Callback callback;
+  VkMemoryPropertyFlags memoryFlags;
+  std::vector<Slot> slots;
+  // next slot to record into and oldest pending slot
+  uint32_t writeSlot = 0;
+  uint32_t readSlot = 0;
+
+  uint64_t offeredCount = 0;
+  uint64_t capturedCount = 0;
+  uint64_t droppedCount = 0;
+  LveRollingStats latencyStats{};
+};
+
+} // namespace lve
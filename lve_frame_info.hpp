@@ -1,15 +1,20 @@
 #pragma once
 
 #include "lve_camera.hpp"
+#include "lve_gpu_profiler.hpp"
 
 #include <vulkan/vulkan.h>
 
 namespace lve {
+// point lights the global ubo holds, matches MAX_LIGHTS in shader.vert
+constexpr uint32_t MAX_LIGHTS = 4;
+
 struct FrameInfo {
   int frameIndex;
   float frameTime;
   VkCommandBuffer commandBuffer;
   LveCamera &camera;
   VkDescriptorSet globalDescriptorSet;
+  LveGpuProfiler *gpuProfiler = nullptr;
 };
 } // namespace lve
@@ -0,0 +1,78 @@
+#include "lve_frame_pacer.hpp"
+
+// std
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+
+namespace lve {
+
+namespace {
+
+double toMs(LveFramePacer::Clock::duration duration) {
+  return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+} // namespace
+
+LveFramePacer::LveFramePacer(double targetFps) { setTargetFps(targetFps); }
+
+void LveFramePacer::setTargetFps(double targetFps) {
+  this->targetFps = targetFps > 0.0 ? targetFps : 0.0;
+  period = isCapped() ? std::chrono::duration_cast<Clock::duration>(
+                            std::chrono::duration<double>(1.0 / targetFps))
+                      : Clock::duration::zero();
+  // restart the deadline sequence from the next frame
+  started = false;
+  jitterStats.clear();
+}
+
+void LveFramePacer::waitForNextFrame() {
+  Clock::time_point now = Clock::now();
+
+  if (isCapped() && started) {
+    if (now - deadline > period) {
+      // fell more than a frame behind, pace from here instead of racing to
+      // catch up on missed deadlines
+      deadline = now;
+    }
+    if (deadline - now > spinThreshold) {
+      std::this_thread::sleep_for(deadline - now - spinThreshold);
+    }
+    while ((now = Clock::now()) < deadline) {
+      std::this_thread::yield();
+    }
+    jitterStats.add(std::abs(toMs(now - deadline)));
+  }
+
+  if (started) {
+    intervalStats.add(toMs(now - lastFrameStart));
+  }
+  if (!started || !isCapped()) {
+    deadline = now;
+  }
+  deadline += period;
+  lastFrameStart = now;
+  started = true;
+}
+
+void LveFramePacer::printStats() const {
+  if (intervalStats.count() == 0) {
+    return;
+  }
+  std::cout << std::fixed << std::setprecision(3);
+  std::cout << "frame pacing (" << (isCapped() ? "capped" : "uncapped");
+  if (isCapped()) {
+    std::cout << " at " << targetFps << " fps";
+  }
+  std::cout << "): interval avg " << intervalStats.average() << " ms  p99 "
+            << intervalStats.percentile(99) << " ms";
+  if (jitterStats.count() > 0) {
+    std::cout << ", jitter avg " << jitterStats.average() << " ms  p99 "
+              << jitterStats.percentile(99) << " ms";
+  }
+  std::cout << std::endl << std::defaultfloat;
+}
+
+} // namespace lve
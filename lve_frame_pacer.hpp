@@ -0,0 +1,51 @@
+#pragma once
+
+#include "lve_stats.hpp"
+
+// std
+#include <chrono>
+
+namespace lve {
+
+// Caps the frame rate on the CPU. Sleeps until shortly before the next frame
+// is due and spins the rest of the way, since sleeps routinely overshoot by
+// a millisecond or more. Deadlines advance by a fixed period so an early or
+// late frame does not shift the ones after it.
+class LveFramePacer {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  // targetFps of 0 leaves the frame rate uncapped
+  explicit LveFramePacer(double targetFps = 0.0);
+
+  void setTargetFps(double targetFps);
+  double getTargetFps() const { return targetFps; }
+  bool isCapped() const { return targetFps > 0.0; }
+
+  // how long before a deadline to stop sleeping and start spinning
+  void setSpinThreshold(std::chrono::microseconds threshold) {
+    spinThreshold = threshold;
+  }
+
+  // blocks until the next frame may start, call once per frame
+  void waitForNextFrame();
+
+  // time between consecutive frame starts
+  const LveRollingStats &getIntervalStats() const { return intervalStats; }
+  // how far each frame start missed its deadline, only tracked when capped
+  const LveRollingStats &getJitterStats() const { return jitterStats; }
+  void printStats() const;
+
+private:
+  double targetFps = 0.0;
+  Clock::duration period{};
+  std::chrono::microseconds spinThreshold{1500};
+  Clock::time_point deadline{};
+  Clock::time_point lastFrameStart{};
+  bool started = false;
+
+  LveRollingStats intervalStats{};
+  LveRollingStats jitterStats{};
+};
+
+} // namespace lve
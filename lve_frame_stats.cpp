@@ -0,0 +1,183 @@
+#include "lve_frame_stats.hpp"
+
+// std
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+namespace lve {
+
+namespace {
+
+constexpr LveFrameStats::Metric allMetrics[] = {
+    LveFrameStats::Metric::Total, LveFrameStats::Metric::FenceWait,
+    LveFrameStats::Metric::Acquire, LveFrameStats::Metric::Record,
+    LveFrameStats::Metric::Present};
+
+} // namespace
+
+const char *LveFrameStats::metricName(Metric metric) {
+  switch (metric) {
+  case Metric::Total:
+    return "total";
+  case Metric::FenceWait:
+    return "fence_wait";
+  case Metric::Acquire:
+    return "acquire";
+  case Metric::Record:
+    return "record";
+  case Metric::Present:
+    return "present";
+  }
+  return "unknown";
+}
+
+double LveFrameStats::value(const Frame &frame, Metric metric) {
+  switch (metric) {
+  case Metric::Total:
+    return frame.totalMs;
+  case Metric::FenceWait:
+    return frame.fenceWaitMs;
+  case Metric::Acquire:
+    return frame.acquireMs;
+  case Metric::Record:
+    return frame.recordMs;
+  case Metric::Present:
+    return frame.presentMs;
+  }
+  return 0.0;
+}
+
+LveFrameStats::LveFrameStats(size_t windowSize)
+    : windowSize{std::max<size_t>(windowSize, 1)},
+      stats(METRIC_COUNT, LveRollingStats{this->windowSize}),
+      histograms(METRIC_COUNT, std::vector<uint64_t>(HISTOGRAM_BUCKETS, 0)) {
+  frames.reserve(this->windowSize);
+}
+
+void LveFrameStats::add(const Frame &frame) {
+  if (frames.size() < windowSize) {
+    frames.push_back(frame);
+  } else {
+    frames[next] = frame;
+  }
+  next = (next + 1) % windowSize;
+  totalFrames++;
+
+  for (Metric metric : allMetrics) {
+    size_t index = static_cast<size_t>(metric);
+    double ms = value(frame, metric);
+    stats[index].add(ms);
+    size_t bucket =
+        static_cast<size_t>(std::max(ms, 0.0) / HISTOGRAM_BUCKET_MS);
+    histograms[index][std::min(bucket, HISTOGRAM_BUCKETS - 1)]++;
+  }
+}
+
+void LveFrameStats::clear() {
+  frames.clear();
+  next = 0;
+  totalFrames = 0;
+  for (auto &metricStats : stats) {
+    metricStats.clear();
+  }
+  for (auto &histogram : histograms) {
+    std::fill(histogram.begin(), histogram.end(), 0);
+  }
+}
+
+const char *LveFrameStats::bottleneck() const {
+  double total = getStats(Metric::Total).average();
+  if (total <= 0.0) {
+    return "unknown";
+  }
+  double gpuShare = getStats(Metric::FenceWait).average() / total;
+  double presentShare = (getStats(Metric::Acquire).average() +
+                         getStats(Metric::Present).average()) /
+                        total;
+  if (gpuShare >= 0.25 && gpuShare >= presentShare) {
+    return "gpu";
+  }
+  if (presentShare >= 0.25) {
+    return "present";
+  }
+  return "cpu";
+}
+
+void LveFrameStats::printStats() const {
+  if (frames.empty()) {
+    return;
+  }
+  std::cout << std::fixed << std::setprecision(3);
+  std::cout << "frame times over " << frames.size() << " frames, likely "
+            << bottleneck() << " bound:" << std::endl;
+  for (Metric metric : allMetrics) {
+    const LveRollingStats &metricStats = getStats(metric);
+    std::cout << "  " << std::left << std::setw(10) << metricName(metric)
+              << std::right << " p50 " << metricStats.percentile(50)
+              << " ms  p95 " << metricStats.percentile(95) << " ms  p99 "
+              << metricStats.percentile(99) << " ms  max "
+              << metricStats.max() << " ms" << std::endl;
+  }
+  std::cout << std::defaultfloat;
+}
+
+bool LveFrameStats::writeCsv(const std::string &path) const {
+  std::ofstream file{path};
+  if (!file) {
+    std::cerr << "frame stats: failed to open " << path << std::endl;
+    return false;
+  }
+  file << "frame";
+  for (Metric metric : allMetrics) {
+    file << "," << metricName(metric) << "_ms";
+  }
+  file << "\n" << std::fixed << std::setprecision(4);
+
+  // once the window is full the oldest frame is the next to be replaced
+  size_t oldest = frames.size() < windowSize ? 0 : next;
+  uint64_t firstFrame = totalFrames - frames.size();
+  for (size_t i = 0; i < frames.size(); i++) {
+    const Frame &frame = frames[(oldest + i) % frames.size()];
+    file << firstFrame + i;
+    for (Metric metric : allMetrics) {
+      file << "," << value(frame, metric);
+    }
+    file << "\n";
+  }
+  if (!file) {
+    std::cerr << "frame stats: failed to write " << path << std::endl;
+    return false;
+  }
+  std::cout << "frame stats: wrote " << frames.size() << " frames to " << path
+            << std::endl;
+  return true;
+}
+
+bool LveFrameStats::writeHistogramCsv(const std::string &path) const {
+  std::ofstream file{path};
+  if (!file) {
+    std::cerr << "frame stats: failed to open " << path << std::endl;
+    return false;
+  }
+  file << "bucket_ms";
+  for (Metric metric : allMetrics) {
+    file << "," << metricName(metric);
+  }
+  file << "\n" << std::fixed << std::setprecision(1);
+  for (size_t bucket = 0; bucket < HISTOGRAM_BUCKETS; bucket++) {
+    file << bucket * HISTOGRAM_BUCKET_MS;
+    for (const auto &histogram : histograms) {
+      file << "," << histogram[bucket];
+    }
+    file << "\n";
+  }
+  if (!file) {
+    std::cerr << "frame stats: failed to write " << path << std::endl;
+    return false;
+  }
+  return true;
+}
+
+} // namespace lve
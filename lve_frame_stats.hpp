@@ -0,0 +1,72 @@
+#pragma once
+
+#include "lve_stats.hpp"
+
+// std
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace lve {
+
+// Where the CPU spent each frame: blocked on the GPU in the fence waits, in
+// vkAcquireNextImageKHR, recording, and in vkQueuePresentKHR. Keeps the last
+// windowSize frames for percentiles and CSV dumps, and a histogram of every
+// frame since the start.
+class LveFrameStats {
+public:
+  static constexpr double HISTOGRAM_BUCKET_MS = 0.5;
+  // the last bucket also counts everything slower
+  static constexpr size_t HISTOGRAM_BUCKETS = 200;
+
+  // milliseconds of CPU time
+  struct Frame {
+    double totalMs = 0.0;
+    double fenceWaitMs = 0.0;
+    double acquireMs = 0.0;
+    double recordMs = 0.0;
+    double presentMs = 0.0;
+  };
+
+  enum class Metric { Total, FenceWait, Acquire, Record, Present };
+  static constexpr size_t METRIC_COUNT = 5;
+  static const char *metricName(Metric metric);
+
+  explicit LveFrameStats(size_t windowSize = 1000);
+
+  void add(const Frame &frame);
+  void clear();
+
+  uint64_t frameCount() const { return totalFrames; }
+  const LveRollingStats &getStats(Metric metric) const {
+    return stats[static_cast<size_t>(metric)];
+  }
+  const std::vector<uint64_t> &getHistogram(Metric metric) const {
+    return histograms[static_cast<size_t>(metric)];
+  }
+
+  // A frame that mostly waits on fences is GPU bound, one that mostly waits
+  // in acquire and present is held back by presentation, anything else is
+  // CPU bound. With FIFO a full present queue also shows up as fence wait.
+  const char *bottleneck() const;
+  void printStats() const;
+
+  // One row per frame in the window, oldest first. Failures are reported on
+  // stderr and return false, a bad path should not end the session.
+  bool writeCsv(const std::string &path) const;
+  // one row per bucket, with a count column per metric
+  bool writeHistogramCsv(const std::string &path) const;
+
+private:
+  static double value(const Frame &frame, Metric metric);
+
+  size_t windowSize;
+  std::vector<Frame> frames;
+  size_t next = 0;
+  uint64_t totalFrames = 0;
+  std::vector<LveRollingStats> stats;
+  std::vector<std::vector<uint64_t>> histograms;
+};
+
+} // namespace lve
@@ -0,0 +1,283 @@
+#include "lve_gpu_profiler.hpp"
+
+// std
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+
+namespace lve {
+
+LveGpuProfiler::Scope::Scope(LveGpuProfiler *profiler,
+                             VkCommandBuffer commandBuffer,
+                             const std::string &name)
+    : profiler{profiler}, commandBuffer{commandBuffer}, scope{NO_SCOPE} {
+  if (profiler != nullptr) {
+    scope = profiler->beginScope(commandBuffer, name);
+  }
+}
+
+LveGpuProfiler::Scope::~Scope() {
+  if (profiler != nullptr) {
+    profiler->endScope(commandBuffer, scope);
+  }
+}
+
+LveGpuProfiler::StatisticsScope::StatisticsScope(
+    LveGpuProfiler *profiler, VkCommandBuffer commandBuffer,
+    const std::string &name)
+    : profiler{profiler}, commandBuffer{commandBuffer}, query{NO_SCOPE} {
+  if (profiler != nullptr) {
+    query = profiler->reserveStatistics(name);
+    profiler->beginStatistics(commandBuffer, query);
+  }
+}
+
+LveGpuProfiler::StatisticsScope::~StatisticsScope() {
+  if (profiler != nullptr) {
+    profiler->endStatistics(commandBuffer, query);
+  }
+}
+
+// the order of the counters in a statistics query result
+static constexpr VkQueryPipelineStatisticFlags STATISTICS_FLAGS =
+    VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_VERTICES_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+static constexpr uint32_t STATISTICS_COUNTERS = 5;
+
+LveGpuProfiler::LveGpuProfiler(LveDevice &device, uint32_t frameCount)
+    : lveDevice{device} {
+  uint32_t validBits = lveDevice.graphicsTimestampValidBits;
+  enabled = validBits > 0;
+  statisticsEnabled = lveDevice.supportsPipelineStatistics();
+  if (!enabled) {
+    std::cout << "gpu profiler: timestamps unsupported on the graphics queue"
+              << std::endl;
+  }
+  timestampMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+  timestampPeriodNs = lveDevice.properties.limits.timestampPeriod;
+  results.resize(std::max(MAX_SCOPES_PER_FRAME * 2,
+                          MAX_STATISTICS_PER_FRAME * STATISTICS_COUNTERS));
+  setFrameCount(frameCount);
+}
+
+LveGpuProfiler::~LveGpuProfiler() { destroyQueryPools(); }
+
+void LveGpuProfiler::setFrameCount(uint32_t frameCount) {
+  destroyQueryPools();
+  currentFrame = 0;
+  frames.clear();
+  frames.resize(frameCount);
+  for (auto &frame : frames) {
+    VkQueryPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    if (enabled) {
+      poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+      poolInfo.queryCount = MAX_SCOPES_PER_FRAME * 2;
+      if (vkCreateQueryPool(lveDevice.device(), &poolInfo,
+                            lveDevice.allocator(),
+                            &frame.queryPool) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create timestamp query pool!");
+      }
+    }
+    if (statisticsEnabled) {
+      poolInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+      poolInfo.queryCount = MAX_STATISTICS_PER_FRAME;
+      poolInfo.pipelineStatistics = STATISTICS_FLAGS;
+      if (vkCreateQueryPool(lveDevice.device(), &poolInfo,
+                            lveDevice.allocator(),
+                            &frame.statisticsPool) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create statistics query pool!");
+      }
+    }
+  }
+}
+
+void LveGpuProfiler::destroyQueryPools() {
+  VkDevice device = lveDevice.device();
+  const VkAllocationCallbacks *allocator = lveDevice.allocator();
+  for (auto &frame : frames) {
+    for (VkQueryPool queryPool : {frame.queryPool, frame.statisticsPool}) {
+      if (queryPool == VK_NULL_HANDLE) {
+        continue;
+      }
+      lveDevice.deferDestruction([device, queryPool, allocator]() {
+        vkDestroyQueryPool(device, queryPool, allocator);
+      });
+    }
+  }
+}
+
+void LveGpuProfiler::beginFrame(VkCommandBuffer commandBuffer,
+                                uint32_t frameIndex) {
+  currentFrame = frameIndex;
+  FrameQueries &frame = frames[currentFrame];
+  if (enabled) {
+    collect(frame);
+    vkCmdResetQueryPool(commandBuffer, frame.queryPool, 0,
+                        MAX_SCOPES_PER_FRAME * 2);
+  }
+  if (statisticsEnabled) {
+    collectStatistics(frame);
+    vkCmdResetQueryPool(commandBuffer, frame.statisticsPool, 0,
+                        MAX_STATISTICS_PER_FRAME);
+  }
+}
+
+void LveGpuProfiler::collect(FrameQueries &frame) {
+  if (frame.scopeNames.empty()) {
+    return;
+  }
+
+  // the frame's fence has passed so this should not block, a frame that was
+  // never submitted just reports not ready and is dropped
+  uint32_t queryCount = static_cast<uint32_t>(frame.scopeNames.size()) * 2;
+  VkResult result = vkGetQueryPoolResults(
+      lveDevice.device(), frame.queryPool, 0, queryCount,
+      queryCount * sizeof(uint64_t), results.data(), sizeof(uint64_t),
+      VK_QUERY_RESULT_64_BIT);
+  if (result == VK_SUCCESS) {
+    // scopes sharing a name within a frame are summed
+    std::map<std::string, double> frameTimes;
+    for (size_t i = 0; i < frame.scopeNames.size(); i++) {
+      uint64_t begin = results[i * 2] & timestampMask;
+      uint64_t end = results[i * 2 + 1] & timestampMask;
+      uint64_t ticks = (end - begin) & timestampMask;
+      frameTimes[frame.scopeNames[i]] +=
+          static_cast<double>(ticks) * timestampPeriodNs / 1e6;
+    }
+    for (const auto &entry : frameTimes) {
+      scopeStats[entry.first].add(entry.second);
+    }
+  }
+  frame.scopeNames.clear();
+}
+
+void LveGpuProfiler::collectStatistics(FrameQueries &frame) {
+  if (frame.statisticsNames.empty()) {
+    return;
+  }
+
+  uint32_t queryCount = static_cast<uint32_t>(frame.statisticsNames.size());
+  VkDeviceSize stride = STATISTICS_COUNTERS * sizeof(uint64_t);
+  VkResult result = vkGetQueryPoolResults(
+      lveDevice.device(), frame.statisticsPool, 0, queryCount,
+      queryCount * stride, results.data(), stride, VK_QUERY_RESULT_64_BIT);
+  if (result == VK_SUCCESS) {
+    pipelineStatistics.clear();
+    for (size_t i = 0; i < frame.statisticsNames.size(); i++) {
+      const uint64_t *counters = &results[i * STATISTICS_COUNTERS];
+      auto &statistics = pipelineStatistics[frame.statisticsNames[i]];
+      statistics.inputAssemblyVertices += counters[0];
+      statistics.inputAssemblyPrimitives += counters[1];
+      statistics.vertexShaderInvocations += counters[2];
+      statistics.clippingPrimitives += counters[3];
+      statistics.fragmentShaderInvocations += counters[4];
+    }
+  }
+  frame.statisticsNames.clear();
+}
+
+uint32_t LveGpuProfiler::beginScope(VkCommandBuffer commandBuffer,
+                                    const std::string &name) {
+  uint32_t scope = reserveScope(name);
+  writeBegin(commandBuffer, scope);
+  return scope;
+}
+
+void LveGpuProfiler::endScope(VkCommandBuffer commandBuffer, uint32_t scope) {
+  writeEnd(commandBuffer, scope);
+}
+
+uint32_t LveGpuProfiler::reserveScope(const std::string &name) {
+  if (!enabled) {
+    return NO_SCOPE;
+  }
+  auto &scopeNames = frames[currentFrame].scopeNames;
+  if (scopeNames.size() == MAX_SCOPES_PER_FRAME) {
+    return NO_SCOPE;
+  }
+  scopeNames.push_back(name);
+  return static_cast<uint32_t>(scopeNames.size() - 1);
+}
+
+void LveGpuProfiler::writeBegin(VkCommandBuffer commandBuffer,
+                                uint32_t scope) {
+  if (scope == NO_SCOPE) {
+    return;
+  }
+  vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                      frames[currentFrame].queryPool, scope * 2);
+}
+
+void LveGpuProfiler::writeEnd(VkCommandBuffer commandBuffer, uint32_t scope) {
+  if (scope == NO_SCOPE) {
+    return;
+  }
+  vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                      frames[currentFrame].queryPool, scope * 2 + 1);
+}
+
+uint32_t LveGpuProfiler::reserveStatistics(const std::string &name) {
+  if (!statisticsEnabled) {
+    return NO_SCOPE;
+  }
+  auto &statisticsNames = frames[currentFrame].statisticsNames;
+  if (statisticsNames.size() == MAX_STATISTICS_PER_FRAME) {
+    return NO_SCOPE;
+  }
+  statisticsNames.push_back(name);
+  return static_cast<uint32_t>(statisticsNames.size() - 1);
+}
+
+void LveGpuProfiler::beginStatistics(VkCommandBuffer commandBuffer,
+                                     uint32_t query) {
+  if (query == NO_SCOPE) {
+    return;
+  }
+  vkCmdBeginQuery(commandBuffer, frames[currentFrame].statisticsPool, query,
+                  0);
+}
+
+void LveGpuProfiler::endStatistics(VkCommandBuffer commandBuffer,
+                                   uint32_t query) {
+  if (query == NO_SCOPE) {
+    return;
+  }
+  vkCmdEndQuery(commandBuffer, frames[currentFrame].statisticsPool, query);
+}
+
+void LveGpuProfiler::printStats() const {
+  if (!scopeStats.empty()) {
+    std::cout << "gpu timings (ms, last "
+              << scopeStats.begin()->second.count() << " frames):" << std::endl;
+    std::cout << std::fixed << std::setprecision(3);
+    for (const auto &entry : scopeStats) {
+      const LveRollingStats &stats = entry.second;
+      std::cout << "\t" << std::left << std::setw(24) << entry.first
+                << std::right << " avg " << stats.average() << "  p50 "
+                << stats.percentile(50) << "  p95 " << stats.percentile(95)
+                << "  p99 " << stats.percentile(99) << std::endl;
+    }
+    std::cout << std::defaultfloat;
+  }
+
+  if (!pipelineStatistics.empty()) {
+    std::cout << "pipeline statistics (last frame):" << std::endl;
+  }
+  for (const auto &entry : pipelineStatistics) {
+    const PipelineStatistics &statistics = entry.second;
+    std::cout << "\t" << entry.first << ": "
+              << statistics.inputAssemblyVertices << " ia vertices, "
+              << statistics.inputAssemblyPrimitives << " ia primitives, "
+              << statistics.vertexShaderInvocations << " vs invocations, "
+              << statistics.clippingPrimitives << " clipping primitives, "
+              << statistics.fragmentShaderInvocations << " fs invocations"
+              << std::endl;
+  }
+}
+
+} // namespace lve
@@ -0,0 +1,135 @@
+#pragma once
+
+#include "lve_device.hpp"
+#include "lve_stats.hpp"
+
+// std
+#include <map>
+#include <string>
+#include <vector>
+
+namespace lve {
+
+// GPU timings from timestamp queries and, when the device has
+// pipelineStatisticsQuery enabled, pipeline statistics, with query pools per
+// frame in flight. A frame's results are read back without waiting when its
+// slot comes around again, after the fence wait in acquireNextImage, and feed
+// a rolling history per scope name.
+class LveGpuProfiler {
+public:
+  static constexpr uint32_t MAX_SCOPES_PER_FRAME = 64;
+  static constexpr uint32_t MAX_STATISTICS_PER_FRAME = 64;
+  static constexpr uint32_t NO_SCOPE = ~0u;
+
+  struct PipelineStatistics {
+    uint64_t inputAssemblyVertices = 0;
+    uint64_t inputAssemblyPrimitives = 0;
+    uint64_t vertexShaderInvocations = 0;
+    uint64_t clippingPrimitives = 0;
+    uint64_t fragmentShaderInvocations = 0;
+  };
+
+  // Times the commands recorded into commandBuffer while it is alive. Cannot
+  // be used in a render pass begun for secondary command buffers.
+  class Scope {
+  public:
+    Scope(LveGpuProfiler *profiler, VkCommandBuffer commandBuffer,
+          const std::string &name);
+    ~Scope();
+
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+
+  private:
+    LveGpuProfiler *profiler;
+    VkCommandBuffer commandBuffer;
+    uint32_t scope;
+  };
+
+  // Counts pipeline statistics for the commands recorded while it is alive.
+  // Has to begin and end in the same subpass, or outside a render pass.
+  class StatisticsScope {
+  public:
+    StatisticsScope(LveGpuProfiler *profiler, VkCommandBuffer commandBuffer,
+                    const std::string &name);
+    ~StatisticsScope();
+
+    StatisticsScope(const StatisticsScope &) = delete;
+    StatisticsScope &operator=(const StatisticsScope &) = delete;
+
+  private:
+    LveGpuProfiler *profiler;
+    VkCommandBuffer commandBuffer;
+    uint32_t query;
+  };
+
+  LveGpuProfiler(LveDevice &device, uint32_t frameCount);
+  ~LveGpuProfiler();
+
+  LveGpuProfiler(const LveGpuProfiler &) = delete;
+  LveGpuProfiler &operator=(const LveGpuProfiler &) = delete;
+
+  // recreates the query pools, results of frames in flight are dropped
+  void setFrameCount(uint32_t frameCount);
+
+  bool isEnabled() const { return enabled; }
+  bool collectsPipelineStatistics() const { return statisticsEnabled; }
+
+  // collects the slot's previous results and resets its pool, has to be
+  // recorded outside a render pass before any scope of the frame
+  void beginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+
+  uint32_t beginScope(VkCommandBuffer commandBuffer, const std::string &name);
+  void endScope(VkCommandBuffer commandBuffer, uint32_t scope);
+
+  // split form for scopes that start and end in different command buffers,
+  // e.g. the first and last of a set of secondary buffers
+  uint32_t reserveScope(const std::string &name);
+  void writeBegin(VkCommandBuffer commandBuffer, uint32_t scope);
+  void writeEnd(VkCommandBuffer commandBuffer, uint32_t scope);
+
+  // Pipeline statistics queries, reserved on the recording thread and then
+  // begun and ended in one command buffer. Queries sharing a name within a
+  // frame are summed, so each secondary buffer can count its own part.
+  uint32_t reserveStatistics(const std::string &name);
+  void beginStatistics(VkCommandBuffer commandBuffer, uint32_t query);
+  void endStatistics(VkCommandBuffer commandBuffer, uint32_t query);
+
+  // counts of the most recent frame read back, by name
+  const std::map<std::string, PipelineStatistics> &
+  getPipelineStatistics() const {
+    return pipelineStatistics;
+  }
+
+  // milliseconds per frame by scope name
+  const std::map<std::string, LveRollingStats> &getScopeStats() const {
+    return scopeStats;
+  }
+  void printStats() const;
+
+private:
+  struct FrameQueries {
+    VkQueryPool queryPool = VK_NULL_HANDLE;
+    std::vector<std::string> scopeNames;
+    VkQueryPool statisticsPool = VK_NULL_HANDLE;
+    std::vector<std::string> statisticsNames;
+  };
+
+  void destroyQueryPools();
+  void collect(FrameQueries &frame);
+  void collectStatistics(FrameQueries &frame);
+
+  LveDevice &lveDevice;
+  bool enabled = false;
+  bool statisticsEnabled = false;
+  double timestampPeriodNs = 1.0;
+  uint64_t timestampMask = ~0ull;
+
+  std::vector<FrameQueries> frames;
+  uint32_t currentFrame = 0;
+  std::vector<uint64_t> results;
+  std::map<std::string, LveRollingStats> scopeStats;
+  std::map<std::string, PipelineStatistics> pipelineStatistics;
+};
+
+} // namespace lve
@@ -0,0 +1,143 @@
+#include "lve_memcpy.hpp"
+
+// std
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define LVE_STREAMING_COPY_X86
+#endif
+
+namespace lve {
+
+#ifdef LVE_STREAMING_COPY_X86
+
+// copies the unaligned head so the stores below can be aligned to `alignment`
+static size_t copyHead(char *&dst, const char *&src, size_t size,
+                       size_t alignment) {
+  size_t misalignment = reinterpret_cast<uintptr_t>(dst) & (alignment - 1);
+  size_t head = misalignment ? alignment - misalignment : 0;
+  if (head > size) {
+    head = size;
+  }
+  memcpy(dst, src, head);
+  dst += head;
+  src += head;
+  return size - head;
+}
+
+__attribute__((target("avx2"))) static void
+streamingCopyAvx2(char *dst, const char *src, size_t size) {
+  size = copyHead(dst, src, size, 32);
+
+  // 128 bytes per iteration, two cache lines worth of full write-combine
+  // buffers
+  while (size >= 128) {
+    __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src));
+    __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + 32));
+    __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + 64));
+    __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + 96));
+    _mm256_stream_si256(reinterpret_cast<__m256i *>(dst), a);
+    _mm256_stream_si256(reinterpret_cast<__m256i *>(dst + 32), b);
+    _mm256_stream_si256(reinterpret_cast<__m256i *>(dst + 64), c);
+    _mm256_stream_si256(reinterpret_cast<__m256i *>(dst + 96), d);
+    src += 128;
+    dst += 128;
+    size -= 128;
+  }
+  while (size >= 32) {
+    __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src));
+    _mm256_stream_si256(reinterpret_cast<__m256i *>(dst), a);
+    src += 32;
+    dst += 32;
+    size -= 32;
+  }
+  memcpy(dst, src, size);
+  _mm_sfence();
+}
+
+__attribute__((target("sse2"))) static void
+streamingCopySse2(char *dst, const char *src, size_t size) {
+  size = copyHead(dst, src, size, 16);
+
+  while (size >= 64) {
+    __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src));
+    __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 16));
+    __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 32));
+    __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 48));
+    _mm_stream_si128(reinterpret_cast<__m128i *>(dst), a);
+    _mm_stream_si128(reinterpret_cast<__m128i *>(dst + 16), b);
+    _mm_stream_si128(reinterpret_cast<__m128i *>(dst + 32), c);
+    _mm_stream_si128(reinterpret_cast<__m128i *>(dst + 48), d);
+    src += 64;
+    dst += 64;
+    size -= 64;
+  }
+  while (size >= 16) {
+    __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src));
+    _mm_stream_si128(reinterpret_cast<__m128i *>(dst), a);
+    src += 16;
+    dst += 16;
+    size -= 16;
+  }
+  memcpy(dst, src, size);
+  _mm_sfence();
+}
+
+enum class CopyPath { Avx2, Sse2, Memcpy };
+
+static CopyPath selectCopyPath() {
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    return CopyPath::Avx2;
+  }
+  if (__builtin_cpu_supports("sse2")) {
+    return CopyPath::Sse2;
+  }
+  return CopyPath::Memcpy;
+}
+
+static CopyPath copyPath() {
+  static const CopyPath path = selectCopyPath();
+  return path;
+}
+
+void streamingCopy(void *dst, const void *src, size_t size) {
+  switch (copyPath()) {
+  case CopyPath::Avx2:
+    streamingCopyAvx2(static_cast<char *>(dst), static_cast<const char *>(src),
+                      size);
+    break;
+  case CopyPath::Sse2:
+    streamingCopySse2(static_cast<char *>(dst), static_cast<const char *>(src),
+                      size);
+    break;
+  case CopyPath::Memcpy:
+    memcpy(dst, src, size);
+    break;
+  }
+}
+
+const char *streamingCopyPath() {
+  switch (copyPath()) {
+  case CopyPath::Avx2:
+    return "avx2";
+  case CopyPath::Sse2:
+    return "sse2";
+  default:
+    return "memcpy";
+  }
+}
+
+#else
+
+void streamingCopy(void *dst, const void *src, size_t size) {
+  memcpy(dst, src, size);
+}
+
+const char *streamingCopyPath() { return "memcpy"; }
+
+#endif
+
+} // namespace lve
@@ -0,0 +1,20 @@
+#pragma once
+
+// std
+#include <cstddef>
+
+namespace lve {
+
+// Copies below this size go through plain memcpy, the setup and fence of the
+// streaming path only pays off for larger writes.
+constexpr size_t STREAMING_COPY_THRESHOLD = 4 * 1024;
+
+// Copy into write-combined (host visible, uncached) memory using aligned
+// non-temporal stores. Uses AVX2 when the cpu supports it, SSE2 otherwise and
+// falls back to memcpy on non-x86 targets. The destination is never read.
+void streamingCopy(void *dst, const void *src, size_t size);
+
+// Name of the instruction set streamingCopy selected on this cpu.
+const char *streamingCopyPath();
+
+} // namespace lve
@@ -1,4 +1,5 @@
 #include "lve_model.hpp"
+#include "lve_startup_profiler.hpp"
 #include "lve_utils.hpp"
 
 #include <cstddef>
@@ -38,6 +39,8 @@ LveModel::~LveModel() {}
 
 std::unique_ptr<LveModel>
 LveModel::createModelFromFile(LveDevice &device, const std::string &filepath) {
+  LveStartupProfiler::Scope profile{"LveModel::createModelFromFile " +
+                                    filepath};
   Builder builder{};
   builder.loadModel(filepath);
 
@@ -50,17 +53,13 @@ void LveModel::createVertexBuffers(const std::vector<Vertex> &vertices) {
   VkDeviceSize bufferSize = sizeof(vertices[0]) * vertexCount;
   uint32_t vertexSize = sizeof(vertices[0]);
 
-  LveBuffer stagingBuffer{
-      lveDevice,
-      vertexSize,
-      vertexCount,
-      VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+  auto stagingBuffer = std::make_shared<LveBuffer>(
+      lveDevice, vertexSize, vertexCount, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
       VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-          VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-  };
+          VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
 
-  stagingBuffer.map();
-  stagingBuffer.writeToBuffer((void *)vertices.data());
+  stagingBuffer->map();
+  stagingBuffer->writeToBuffer((void *)vertices.data());
 
   vertexBuffer = std::make_unique<LveBuffer>(
       lveDevice, vertexSize, vertexCount,
@@ -69,8 +68,10 @@ void LveModel::createVertexBuffers(const std::vector<Vertex> &vertices) {
 
   );
 
-  lveDevice.copyBuffer(stagingBuffer.getBuffer(), vertexBuffer->getBuffer(),
-                       bufferSize);
+  // the staging buffer is released once the transfer queue is done with it
+  lveDevice.copyBufferAsync(
+      stagingBuffer->getBuffer(), vertexBuffer->getBuffer(), bufferSize,
+      [stagingBuffer]() mutable { stagingBuffer.reset(); });
 }
 
 void LveModel::createIndexBuffers(const std::vector<uint32_t> &indices) {
@@ -84,21 +85,22 @@ void LveModel::createIndexBuffers(const std::vector<uint32_t> &indices) {
   VkDeviceSize bufferSize = sizeof(indices[0]) * indexCount;
   uint32_t indexSize = sizeof(indices[0]);
 
-  LveBuffer stagingBuffer{lveDevice, indexSize, indexCount,
-                          VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                          VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-                              VK_MEMORY_PROPERTY_HOST_COHERENT_BIT};
+  auto stagingBuffer = std::make_shared<LveBuffer>(
+      lveDevice, indexSize, indexCount, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+          VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
 
-  stagingBuffer.map();
-  stagingBuffer.writeToBuffer((void *)indices.data());
+  stagingBuffer->map();
+  stagingBuffer->writeToBuffer((void *)indices.data());
 
   indexBuffer = std::make_unique<LveBuffer>(
       lveDevice, indexSize, indexCount,
       VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
       VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
 
-  lveDevice.copyBuffer(stagingBuffer.getBuffer(), indexBuffer->getBuffer(),
-                       bufferSize);
+  lveDevice.copyBufferAsync(
+      stagingBuffer->getBuffer(), indexBuffer->getBuffer(), bufferSize,
+      [stagingBuffer]() mutable { stagingBuffer.reset(); });
 }
 
 void LveModel::draw(VkCommandBuffer commandBuffer) {
@@ -144,6 +146,11 @@ LveModel::Vertex::getAttributeDescriptions() {
   return attributeDescriptions;
 }
 
+std::vector<VkVertexInputAttributeDescription>
+LveModel::Vertex::getPositionAttributeDescriptions() {
+  return {{0, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, position)}};
+}
+
 void LveModel::Builder::loadModel(const std::string &filepath) {
   tinyobj::attrib_t attrib;
   std::vector<tinyobj::shape_t> shapes;
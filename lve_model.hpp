@@ -27,6 +27,9 @@ public:
     getBindingDescriptions();
     static std::vector<VkVertexInputAttributeDescription>
     getAttributeDescriptions();
+    // just the position, for depth only passes
+    static std::vector<VkVertexInputAttributeDescription>
+    getPositionAttributeDescriptions();
 
     bool operator==(const Vertex &other) const {
       return position == other.position && color == other.color &&
@@ -53,6 +56,9 @@ public:
   void bind(VkCommandBuffer commandBuffer);
   void draw(VkCommandBuffer commandBuffer);
 
+  // unique vertices, each is shaded at least once per draw
+  uint32_t getVertexCount() const { return vertexCount; }
+
 private:
   void createVertexBuffers(const std::vector<Vertex> &vertices);
   void createIndexBuffers(const std::vector<uint32_t> &indices);
@@ -1,11 +1,14 @@
 #include "lve_pipeline.hpp"
 
 #include "lve_model.hpp"
+#include "lve_startup_profiler.hpp"
 
 // std
 #include <cassert>
+#include <chrono>
 #include <fstream>
 #include <iostream>
+#include <sstream>
 #include <stdexcept>
 
 namespace lve {
@@ -18,9 +21,19 @@ LvePipeline::LvePipeline(LveDevice &device, const std::string &vertFilepath,
 }
 
 LvePipeline::~LvePipeline() {
-  vkDestroyShaderModule(lveDevice.device(), vertShaderModule, nullptr);
-  vkDestroyShaderModule(lveDevice.device(), fragShaderModule, nullptr);
-  vkDestroyPipeline(lveDevice.device(), graphicsPipeline, nullptr);
+  VkDevice device = lveDevice.device();
+  VkShaderModule vertShaderModule = this->vertShaderModule;
+  VkShaderModule fragShaderModule = this->fragShaderModule;
+  VkPipeline graphicsPipeline = this->graphicsPipeline;
+  const VkAllocationCallbacks *allocator = lveDevice.allocator();
+  lveDevice.deferDestruction([device, vertShaderModule, fragShaderModule,
+                              graphicsPipeline, allocator]() {
+    vkDestroyShaderModule(device, vertShaderModule, allocator);
+    if (fragShaderModule != VK_NULL_HANDLE) {
+      vkDestroyShaderModule(device, fragShaderModule, allocator);
+    }
+    vkDestroyPipeline(device, graphicsPipeline, allocator);
+  });
 }
 
 std::vector<char> LvePipeline::readFile(const std::string &filepath) {
@@ -43,18 +56,36 @@ std::vector<char> LvePipeline::readFile(const std::string &filepath) {
 void LvePipeline::createGraphicsPipeline(const std::string &vertFilepath,
                                          const std::string &fragFilepath,
                                          const PipelineConfigInfo &configInfo) {
+  LveStartupProfiler::Scope profile{
+      "LvePipeline " + vertFilepath +
+      (fragFilepath.empty() ? "" : " + " + fragFilepath)};
   assert(configInfo.pipelineLayout != VK_NULL_HANDLE &&
          "Cannot create graphics pipeline: no pipelineLayout provided in "
          "configInfo");
-  assert(
-      configInfo.renderPass != VK_NULL_HANDLE &&
-      "Cannot create graphics pipeline: no renderPass provided in configInfo");
+  assert((configInfo.target.renderPass != VK_NULL_HANDLE ||
+          configInfo.target.colorFormat != VK_FORMAT_UNDEFINED ||
+          configInfo.target.depthFormat != VK_FORMAT_UNDEFINED) &&
+         "Cannot create graphics pipeline: no render target provided in "
+         "configInfo");
 
   auto vertCode = readFile(vertFilepath);
-  auto fragCode = readFile(fragFilepath);
-
   createShaderModule(vertCode, &vertShaderModule);
-  createShaderModule(fragCode, &fragShaderModule);
+  if (!fragFilepath.empty()) {
+    auto fragCode = readFile(fragFilepath);
+    createShaderModule(fragCode, &fragShaderModule);
+  }
+
+  // constants a stage does not declare are ignored by it
+  VkSpecializationInfo specializationInfo{};
+  specializationInfo.mapEntryCount =
+      static_cast<uint32_t>(configInfo.specializationEntries.size());
+  specializationInfo.pMapEntries = configInfo.specializationEntries.data();
+  specializationInfo.dataSize =
+      configInfo.specializationData.size() * sizeof(uint32_t);
+  specializationInfo.pData = configInfo.specializationData.data();
+  const VkSpecializationInfo *stageSpecialization =
+      configInfo.specializationEntries.empty() ? nullptr
+                                               : &specializationInfo;
 
   VkPipelineShaderStageCreateInfo shaderStages[2];
   shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -63,17 +94,17 @@ void LvePipeline::createGraphicsPipeline(const std::string &vertFilepath,
   shaderStages[0].pName = "main";
   shaderStages[0].flags = 0;
   shaderStages[0].pNext = nullptr;
-  shaderStages[0].pSpecializationInfo = nullptr;
+  shaderStages[0].pSpecializationInfo = stageSpecialization;
   shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
   shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
   shaderStages[1].module = fragShaderModule;
   shaderStages[1].pName = "main";
   shaderStages[1].flags = 0;
   shaderStages[1].pNext = nullptr;
-  shaderStages[1].pSpecializationInfo = nullptr;
+  shaderStages[1].pSpecializationInfo = stageSpecialization;
 
-  auto bindingDescriptions = LveModel::Vertex::getBindingDescriptions();
-  auto attributeDescriptions = LveModel::Vertex::getAttributeDescriptions();
+  auto &bindingDescriptions = configInfo.bindingDescriptions;
+  auto &attributeDescriptions = configInfo.attributeDescriptions;
   VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
   vertexInputInfo.sType =
       VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
@@ -86,7 +117,7 @@ void LvePipeline::createGraphicsPipeline(const std::string &vertFilepath,
 
   VkGraphicsPipelineCreateInfo pipelineInfo{};
   pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-  pipelineInfo.stageCount = 2;
+  pipelineInfo.stageCount = fragShaderModule != VK_NULL_HANDLE ? 2 : 1;
   pipelineInfo.pStages = shaderStages;
   pipelineInfo.pVertexInputState = &vertexInputInfo;
   pipelineInfo.pInputAssemblyState = &configInfo.inputAssemblyInfo;
@@ -98,17 +129,41 @@ void LvePipeline::createGraphicsPipeline(const std::string &vertFilepath,
   pipelineInfo.pDynamicState = &configInfo.dynamicStateInfo;
 
   pipelineInfo.layout = configInfo.pipelineLayout;
-  pipelineInfo.renderPass = configInfo.renderPass;
-  pipelineInfo.subpass = configInfo.subpass;
+  pipelineInfo.renderPass = configInfo.target.renderPass;
+  pipelineInfo.subpass = configInfo.target.subpass;
+
+  const PipelineTargetInfo &target = configInfo.target;
+  VkPipelineRenderingCreateInfo renderingInfo{};
+  renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+  renderingInfo.colorAttachmentCount =
+      target.colorFormat != VK_FORMAT_UNDEFINED ? 1 : 0;
+  renderingInfo.pColorAttachmentFormats = &target.colorFormat;
+  renderingInfo.depthAttachmentFormat = target.depthFormat;
+  renderingInfo.stencilAttachmentFormat = target.stencilFormat;
+  if (target.renderPass == VK_NULL_HANDLE) {
+    pipelineInfo.pNext = &renderingInfo;
+  }
 
   pipelineInfo.basePipelineIndex = -1;
   pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
 
-  if (vkCreateGraphicsPipelines(lveDevice.device(), VK_NULL_HANDLE, 1,
-                                &pipelineInfo, nullptr,
+  auto start = std::chrono::high_resolution_clock::now();
+  if (vkCreateGraphicsPipelines(lveDevice.device(), lveDevice.pipelineCache(),
+                                1, &pipelineInfo, lveDevice.allocator(),
                                 &graphicsPipeline) != VK_SUCCESS) {
     throw std::runtime_error("failed to create graphics pipeline");
   }
+  auto end = std::chrono::high_resolution_clock::now();
+
+  // built up front so lines from concurrent builds don't interleave
+  std::ostringstream log;
+  log << "graphics pipeline " << vertFilepath << " + "
+      << (fragFilepath.empty() ? "depth only" : fragFilepath)
+      << " created in "
+      << std::chrono::duration<float, std::milli>(end - start).count()
+      << " ms (" << (lveDevice.isPipelineCacheWarm() ? "warm" : "cold")
+      << " pipeline cache)\n";
+  std::cout << log.str() << std::flush;
 }
 
 void LvePipeline::createShaderModule(const std::vector<char> &code,
@@ -118,7 +173,8 @@ void LvePipeline::createShaderModule(const std::vector<char> &code,
   createInfo.codeSize = code.size();
   createInfo.pCode = reinterpret_cast<const uint32_t *>(code.data());
 
-  if (vkCreateShaderModule(lveDevice.device(), &createInfo, nullptr,
+  if (vkCreateShaderModule(lveDevice.device(), &createInfo,
+                           lveDevice.allocator(),
                            shaderModule) != VK_SUCCESS) {
     throw std::runtime_error("failed to create shader module");
   }
@@ -202,6 +258,10 @@ void LvePipeline::defaultPipelineConfigInfo(PipelineConfigInfo &configInfo) {
   configInfo.depthStencilInfo.front = {}; // Optional
   configInfo.depthStencilInfo.back = {};  // Optional
 
+  configInfo.bindingDescriptions = LveModel::Vertex::getBindingDescriptions();
+  configInfo.attributeDescriptions =
+      LveModel::Vertex::getAttributeDescriptions();
+
   configInfo.dynamicStateEnables = {VK_DYNAMIC_STATE_VIEWPORT,
                                     VK_DYNAMIC_STATE_SCISSOR};
   configInfo.dynamicStateInfo.sType =
@@ -213,4 +273,23 @@ void LvePipeline::defaultPipelineConfigInfo(PipelineConfigInfo &configInfo) {
   configInfo.dynamicStateInfo.flags = 0;
 }
 
+void LvePipeline::setSpecializationConstant(PipelineConfigInfo &configInfo,
+                                            uint32_t constantId,
+                                            uint32_t value) {
+  for (const auto &entry : configInfo.specializationEntries) {
+    if (entry.constantID == constantId) {
+      configInfo.specializationData[entry.offset / sizeof(uint32_t)] = value;
+      return;
+    }
+  }
+  VkSpecializationMapEntry entry{};
+  entry.constantID = constantId;
+  entry.offset =
+      static_cast<uint32_t>(configInfo.specializationData.size() *
+                            sizeof(uint32_t));
+  entry.size = sizeof(uint32_t);
+  configInfo.specializationEntries.push_back(entry);
+  configInfo.specializationData.push_back(value);
+}
+
 } // namespace lve
@@ -8,10 +8,24 @@
 
 namespace lve {
 
+// What a pipeline renders into. Either a render pass and subpass, or with
+// dynamic rendering just the attachment formats, so a pipeline outlives any
+// render pass or framebuffer recreation.
+struct PipelineTargetInfo {
+  VkRenderPass renderPass = VK_NULL_HANDLE;
+  uint32_t subpass = 0;
+  VkFormat colorFormat = VK_FORMAT_UNDEFINED;
+  VkFormat depthFormat = VK_FORMAT_UNDEFINED;
+  VkFormat stencilFormat = VK_FORMAT_UNDEFINED;
+};
+
 struct PipelineConfigInfo {
+  PipelineConfigInfo() = default;
   PipelineConfigInfo(const PipelineConfigInfo &) = delete;
   PipelineConfigInfo &operator=(const PipelineConfigInfo &) = delete;
 
+  std::vector<VkVertexInputBindingDescription> bindingDescriptions{};
+  std::vector<VkVertexInputAttributeDescription> attributeDescriptions{};
   VkPipelineViewportStateCreateInfo viewportInfo;
   VkPipelineInputAssemblyStateCreateInfo inputAssemblyInfo;
   VkPipelineRasterizationStateCreateInfo rasterizationInfo;
@@ -22,12 +36,16 @@ struct PipelineConfigInfo {
   std::vector<VkDynamicState> dynamicStateEnables;
   VkPipelineDynamicStateCreateInfo dynamicStateInfo;
   VkPipelineLayout pipelineLayout = nullptr;
-  VkRenderPass renderPass = nullptr;
-  uint32_t subpass = 0;
+  PipelineTargetInfo target{};
+  // shared by all stages, filled through setSpecializationConstant
+  std::vector<VkSpecializationMapEntry> specializationEntries{};
+  std::vector<uint32_t> specializationData{};
 };
 
 class LvePipeline {
 public:
+  // an empty fragFilePath builds a depth only pipeline without a fragment
+  // stage
   LvePipeline(LveDevice &device, const std::string &vertFilePath,
               const std::string &fragFilePath,
               const PipelineConfigInfo &configInfo);
@@ -38,6 +56,10 @@ public:
   void bind(VkCommandBuffer commandBuffer);
 
   static void defaultPipelineConfigInfo(PipelineConfigInfo &configInfo);
+  // bool, int and uint constants are all 32 bits, bools take VK_TRUE or
+  // VK_FALSE
+  static void setSpecializationConstant(PipelineConfigInfo &configInfo,
+                                        uint32_t constantId, uint32_t value);
 
 private:
   static std::vector<char> readFile(const std::string &filepath);
@@ -52,6 +74,6 @@ private:
   LveDevice &lveDevice;
   VkPipeline graphicsPipeline;
   VkShaderModule vertShaderModule;
-  VkShaderModule fragShaderModule;
+  VkShaderModule fragShaderModule = VK_NULL_HANDLE;
 };
 } // namespace lve
@@ -0,0 +1,37 @@
+#include "lve_pipeline_compiler.hpp"
+
+// std
+#include <utility>
+
+namespace lve {
+
+LvePipelineCompiler::LvePipelineCompiler(LveDevice &device,
+                                         LveThreadPool &threadPool)
+    : lveDevice{device}, threadPool{threadPool} {}
+
+std::future<std::unique_ptr<LvePipeline>>
+LvePipelineCompiler::build(const std::string &vertFilepath,
+                           const std::string &fragFilepath,
+                           std::unique_ptr<PipelineConfigInfo> configInfo) {
+  // std::function needs a copyable callable, so the config travels as a
+  // shared_ptr
+  std::shared_ptr<PipelineConfigInfo> config{std::move(configInfo)};
+  LveDevice *device = &lveDevice;
+  return threadPool.submit([device, vertFilepath, fragFilepath, config]() {
+    return std::make_unique<LvePipeline>(*device, vertFilepath, fragFilepath,
+                                         *config);
+  });
+}
+
+std::vector<std::future<std::unique_ptr<LvePipeline>>>
+LvePipelineCompiler::buildBatch(std::vector<PipelineBuildRequest> requests) {
+  std::vector<std::future<std::unique_ptr<LvePipeline>>> pipelines;
+  pipelines.reserve(requests.size());
+  for (auto &request : requests) {
+    pipelines.push_back(build(request.vertFilepath, request.fragFilepath,
+                              std::move(request.configInfo)));
+  }
+  return pipelines;
+}
+
+} // namespace lve
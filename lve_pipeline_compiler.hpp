@@ -0,0 +1,43 @@
+#pragma once
+
+#include "lve_device.hpp"
+#include "lve_pipeline.hpp"
+#include "lve_thread_pool.hpp"
+
+// std
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace lve {
+
+struct PipelineBuildRequest {
+  std::string vertFilepath;
+  std::string fragFilepath;
+  // owned by the build, it has to stay alive until the worker is done
+  std::unique_ptr<PipelineConfigInfo> configInfo;
+};
+
+// Compiles pipelines on the worker pool. All builds share the device's
+// pipeline cache, which vulkan synchronizes internally. The returned futures
+// have to be resolved on the main thread, pipelines are destroyed there.
+class LvePipelineCompiler {
+public:
+  LvePipelineCompiler(LveDevice &device, LveThreadPool &threadPool);
+
+  LvePipelineCompiler(const LvePipelineCompiler &) = delete;
+  LvePipelineCompiler &operator=(const LvePipelineCompiler &) = delete;
+
+  std::future<std::unique_ptr<LvePipeline>>
+  build(const std::string &vertFilepath, const std::string &fragFilepath,
+        std::unique_ptr<PipelineConfigInfo> configInfo);
+  std::vector<std::future<std::unique_ptr<LvePipeline>>>
+  buildBatch(std::vector<PipelineBuildRequest> requests);
+
+private:
+  LveDevice &lveDevice;
+  LveThreadPool &threadPool;
+};
+
+} // namespace lve
@@ -0,0 +1,151 @@
+#include "lve_pipeline_variants.hpp"
+
+// std
+#include <cassert>
+#include <chrono>
+#include <type_traits>
+#include <utility>
+
+namespace lve {
+
+namespace {
+
+// only for types without pointers, the create infos are taken field by field
+template <typename T> void appendBytes(std::string &key, const T &value) {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "variant key fields have to be plain data");
+  key.append(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+template <typename T>
+void appendBytes(std::string &key, const std::vector<T> &values) {
+  appendBytes(key, values.size());
+  for (const auto &value : values) {
+    appendBytes(key, value);
+  }
+}
+
+} // namespace
+
+LvePipelineVariants::LvePipelineVariants(LvePipelineCompiler &pipelineCompiler,
+                                         const std::string &vertFilepath,
+                                         const std::string &fragFilepath)
+    : pipelineCompiler{pipelineCompiler}, vertFilepath{vertFilepath},
+      fragFilepath{fragFilepath} {}
+
+LvePipelineVariants::~LvePipelineVariants() { wait(); }
+
+LvePipelineVariants::VariantId
+LvePipelineVariants::request(std::unique_ptr<PipelineConfigInfo> configInfo) {
+  std::string key = variantKey(*configInfo);
+  auto found = variantIds.find(key);
+  if (found != variantIds.end()) {
+    return found->second;
+  }
+
+  VariantId variant = static_cast<VariantId>(variants.size());
+  variants.push_back(
+      {pipelineCompiler.build(vertFilepath, fragFilepath,
+                              std::move(configInfo)),
+       nullptr});
+  variantIds.emplace(std::move(key), variant);
+  return variant;
+}
+
+LvePipeline &LvePipelineVariants::get(VariantId variant) {
+  Variant &entry = variants[variant];
+  assert((entry.pipeline || entry.future.valid()) &&
+         "pipeline variant was released");
+  if (!entry.pipeline) {
+    entry.pipeline = entry.future.get();
+  }
+  return *entry.pipeline;
+}
+
+bool LvePipelineVariants::ready(VariantId variant) const {
+  const Variant &entry = variants[variant];
+  return entry.pipeline != nullptr ||
+         entry.future.wait_for(std::chrono::seconds(0)) ==
+             std::future_status::ready;
+}
+
+void LvePipelineVariants::release(VariantId variant) {
+  Variant &entry = variants[variant];
+  if (entry.future.valid()) {
+    entry.future.wait();
+    entry.future = {};
+  }
+  entry.pipeline.reset();
+  for (auto it = variantIds.begin(); it != variantIds.end(); ++it) {
+    if (it->second == variant) {
+      variantIds.erase(it);
+      break;
+    }
+  }
+}
+
+void LvePipelineVariants::wait() {
+  for (auto &variant : variants) {
+    if (variant.future.valid()) {
+      variant.future.wait();
+    }
+  }
+}
+
+std::string
+LvePipelineVariants::variantKey(const PipelineConfigInfo &configInfo) {
+  std::string key;
+  appendBytes(key, configInfo.bindingDescriptions);
+  appendBytes(key, configInfo.attributeDescriptions);
+
+  appendBytes(key, configInfo.viewportInfo.viewportCount);
+  appendBytes(key, configInfo.viewportInfo.scissorCount);
+  appendBytes(key, configInfo.inputAssemblyInfo.topology);
+  appendBytes(key, configInfo.inputAssemblyInfo.primitiveRestartEnable);
+
+  const auto &rasterization = configInfo.rasterizationInfo;
+  appendBytes(key, rasterization.depthClampEnable);
+  appendBytes(key, rasterization.rasterizerDiscardEnable);
+  appendBytes(key, rasterization.polygonMode);
+  appendBytes(key, rasterization.cullMode);
+  appendBytes(key, rasterization.frontFace);
+  appendBytes(key, rasterization.depthBiasEnable);
+  appendBytes(key, rasterization.depthBiasConstantFactor);
+  appendBytes(key, rasterization.depthBiasClamp);
+  appendBytes(key, rasterization.depthBiasSlopeFactor);
+  appendBytes(key, rasterization.lineWidth);
+
+  const auto &multisample = configInfo.multisampleInfo;
+  appendBytes(key, multisample.rasterizationSamples);
+  appendBytes(key, multisample.sampleShadingEnable);
+  appendBytes(key, multisample.minSampleShading);
+  appendBytes(key, multisample.alphaToCoverageEnable);
+  appendBytes(key, multisample.alphaToOneEnable);
+
+  appendBytes(key, configInfo.colorBlendAttachment);
+  appendBytes(key, configInfo.colorBlendInfo.logicOpEnable);
+  appendBytes(key, configInfo.colorBlendInfo.logicOp);
+  appendBytes(key, configInfo.colorBlendInfo.attachmentCount);
+  appendBytes(key, configInfo.colorBlendInfo.blendConstants);
+
+  const auto &depthStencil = configInfo.depthStencilInfo;
+  appendBytes(key, depthStencil.depthTestEnable);
+  appendBytes(key, depthStencil.depthWriteEnable);
+  appendBytes(key, depthStencil.depthCompareOp);
+  appendBytes(key, depthStencil.depthBoundsTestEnable);
+  appendBytes(key, depthStencil.stencilTestEnable);
+  appendBytes(key, depthStencil.front);
+  appendBytes(key, depthStencil.back);
+  appendBytes(key, depthStencil.minDepthBounds);
+  appendBytes(key, depthStencil.maxDepthBounds);
+
+  appendBytes(key, configInfo.dynamicStateEnables);
+  appendBytes(key, configInfo.pipelineLayout);
+  appendBytes(key, configInfo.target);
+
+  appendBytes(key, configInfo.specializationEntries);
+  appendBytes(key, configInfo.specializationData);
+  return key;
+}
+
+} // namespace lve
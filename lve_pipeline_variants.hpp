@@ -0,0 +1,72 @@
+#pragma once
+
+#include "lve_pipeline.hpp"
+#include "lve_pipeline_compiler.hpp"
+
+// std
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace lve {
+
+// Pipelines of one shader pair, one per distinct combination of
+// specialization constants and fixed function state. A variant is compiled
+// in the background the first time it is requested and kept until it is
+// released or the cache is destroyed, so switching back to a combination
+// used before is free.
+class LvePipelineVariants {
+public:
+  using VariantId = uint32_t;
+  static constexpr VariantId NO_VARIANT = UINT32_MAX;
+
+  LvePipelineVariants(LvePipelineCompiler &pipelineCompiler,
+                      const std::string &vertFilepath,
+                      const std::string &fragFilepath);
+  ~LvePipelineVariants();
+
+  LvePipelineVariants(const LvePipelineVariants &) = delete;
+  LvePipelineVariants &operator=(const LvePipelineVariants &) = delete;
+
+  // Starts compiling the variant configInfo describes unless an equal one
+  // was requested before. The id stays valid until it is released.
+  VariantId request(std::unique_ptr<PipelineConfigInfo> configInfo);
+  // blocks on the first use of a variant still compiling
+  LvePipeline &get(VariantId variant);
+  // whether get would return without waiting for the compile
+  bool ready(VariantId variant) const;
+  // Waits for the compile and destroys the pipeline once the frames using it
+  // have retired. An equal config requested afterwards compiles again, so a
+  // variant built against a render pass that was destroyed is not handed
+  // out for a new render pass that got the same handle.
+  void release(VariantId variant);
+
+  // the workers use the configs' pipeline layouts, which have to outlive
+  // any build still running
+  void wait();
+
+  size_t size() const { return variants.size(); }
+
+private:
+  struct Variant {
+    std::future<std::unique_ptr<LvePipeline>> future;
+    std::unique_ptr<LvePipeline> pipeline;
+  };
+
+  // every field that ends up in the pipeline, byte for byte
+  static std::string variantKey(const PipelineConfigInfo &configInfo);
+
+  LvePipelineCompiler &pipelineCompiler;
+  std::string vertFilepath;
+  std::string fragFilepath;
+
+  std::vector<Variant> variants;
+  // hashed by std::hash, compared in full so a collision cannot alias two
+  // variants
+  std::unordered_map<std::string, VariantId> variantIds;
+};
+
+} // namespace lve
@@ -0,0 +1,1034 @@
+#include "lve_render_graph.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+#include <stdexcept>
+
+namespace lve {
+
+namespace {
+
+struct UsageInfo {
+  VkImageLayout layout;
+  VkAccessFlags access;
+  VkImageUsageFlags imageUsage;
+  bool write;
+};
+
+UsageInfo usageInfo(LveRenderGraph::Usage usage) {
+  switch (usage) {
+  case LveRenderGraph::Usage::ColorAttachment:
+    return {VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+            VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+            VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, true};
+  case LveRenderGraph::Usage::DepthAttachment:
+    return {VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+            VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT |
+                VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+            VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, true};
+  case LveRenderGraph::Usage::DepthReadOnly:
+    return {VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
+            VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT,
+            VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, false};
+  case LveRenderGraph::Usage::Sampled:
+    return {VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_SHADER_READ_BIT,
+            VK_IMAGE_USAGE_SAMPLED_BIT, false};
+  case LveRenderGraph::Usage::TransferSrc:
+    return {VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_ACCESS_TRANSFER_READ_BIT,
+            VK_IMAGE_USAGE_TRANSFER_SRC_BIT, false};
+  case LveRenderGraph::Usage::TransferDst:
+    return {VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT,
+            VK_IMAGE_USAGE_TRANSFER_DST_BIT, true};
+  }
+  throw std::runtime_error("unknown render graph image usage!");
+}
+
+bool readsImage(LveRenderGraph::Usage usage, VkAttachmentLoadOp loadOp) {
+  return !usageInfo(usage).write || loadOp == VK_ATTACHMENT_LOAD_OP_LOAD;
+}
+
+bool isAttachment(LveRenderGraph::Usage usage) {
+  return usage == LveRenderGraph::Usage::ColorAttachment ||
+         usage == LveRenderGraph::Usage::DepthAttachment ||
+         usage == LveRenderGraph::Usage::DepthReadOnly;
+}
+
+bool hasStencilComponent(VkFormat format) {
+  return format == VK_FORMAT_D32_SFLOAT_S8_UINT ||
+         format == VK_FORMAT_D24_UNORM_S8_UINT ||
+         format == VK_FORMAT_D16_UNORM_S8_UINT;
+}
+
+VkImageAspectFlags aspectMask(VkFormat format) {
+  switch (format) {
+  case VK_FORMAT_D16_UNORM:
+  case VK_FORMAT_X8_D24_UNORM_PACK32:
+  case VK_FORMAT_D32_SFLOAT:
+    return VK_IMAGE_ASPECT_DEPTH_BIT;
+  case VK_FORMAT_D16_UNORM_S8_UINT:
+  case VK_FORMAT_D24_UNORM_S8_UINT:
+  case VK_FORMAT_D32_SFLOAT_S8_UINT:
+    return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+  default:
+    return VK_IMAGE_ASPECT_COLOR_BIT;
+  }
+}
+
+} // namespace
+
+LveRenderGraph::PassBuilder &
+LveRenderGraph::PassBuilder::writeColor(ResourceId image,
+                                        VkAttachmentLoadOp loadOp,
+                                        VkClearColorValue clearValue) {
+  for (const auto &access : graph.passes[pass].accesses) {
+    if (access.usage == Usage::ColorAttachment) {
+      throw std::runtime_error(
+          "render graph passes have at most one color attachment!");
+    }
+  }
+  VkClearValue clear{};
+  clear.color = clearValue;
+  graph.addAccess(pass, image, Usage::ColorAttachment,
+                  VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, loadOp,
+                  clear);
+  return *this;
+}
+
+LveRenderGraph::PassBuilder &
+LveRenderGraph::PassBuilder::writeDepth(ResourceId image,
+                                        VkAttachmentLoadOp loadOp,
+                                        float clearDepth) {
+  VkClearValue clear{};
+  clear.depthStencil = {clearDepth, 0};
+  graph.addAccess(pass, image, Usage::DepthAttachment,
+                  VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT |
+                      VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+                  loadOp, clear);
+  return *this;
+}
+
+LveRenderGraph::PassBuilder &
+LveRenderGraph::PassBuilder::readDepth(ResourceId image) {
+  graph.addAccess(pass, image, Usage::DepthReadOnly,
+                  VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT |
+                      VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+                  VK_ATTACHMENT_LOAD_OP_LOAD, {});
+  return *this;
+}
+
+LveRenderGraph::PassBuilder &
+LveRenderGraph::PassBuilder::sample(ResourceId image,
+                                    VkPipelineStageFlags stages) {
+  graph.addAccess(pass, image, Usage::Sampled, stages,
+                  VK_ATTACHMENT_LOAD_OP_DONT_CARE, {});
+  return *this;
+}
+
+LveRenderGraph::PassBuilder &
+LveRenderGraph::PassBuilder::copyFrom(ResourceId image) {
+  graph.addAccess(pass, image, Usage::TransferSrc,
+                  VK_PIPELINE_STAGE_TRANSFER_BIT,
+                  VK_ATTACHMENT_LOAD_OP_DONT_CARE, {});
+  return *this;
+}
+
+LveRenderGraph::PassBuilder &
+LveRenderGraph::PassBuilder::copyTo(ResourceId image) {
+  graph.addAccess(pass, image, Usage::TransferDst,
+                  VK_PIPELINE_STAGE_TRANSFER_BIT,
+                  VK_ATTACHMENT_LOAD_OP_DONT_CARE, {});
+  return *this;
+}
+
+LveRenderGraph::PassBuilder &LveRenderGraph::PassBuilder::setSideEffects() {
+  graph.passes[pass].sideEffects = true;
+  return *this;
+}
+
+LveRenderGraph::PassBuilder &
+LveRenderGraph::PassBuilder::setSecondaryCommandBuffers() {
+  graph.passes[pass].secondaryCommandBuffers = true;
+  return *this;
+}
+
+LveRenderGraph::PassBuilder &
+LveRenderGraph::PassBuilder::setDynamicResolution() {
+  graph.passes[pass].dynamicResolution = true;
+  return *this;
+}
+
+LveRenderGraph::LveRenderGraph(LveDevice &device, LveRenderer &renderer)
+    : lveDevice{device}, lveRenderer{renderer} {}
+
+LveRenderGraph::~LveRenderGraph() { reset(); }
+
+LveRenderGraph::ResourceId
+LveRenderGraph::createImage(const std::string &name, const ImageDesc &desc) {
+  return addResource(name, ResourceKind::Transient, desc);
+}
+
+LveRenderGraph::ResourceId
+LveRenderGraph::importSwapChainImage(const std::string &name) {
+  return addResource(name, ResourceKind::SwapChainImage, {});
+}
+
+LveRenderGraph::ResourceId
+LveRenderGraph::importSwapChainDepth(const std::string &name) {
+  return addResource(name, ResourceKind::SwapChainDepth, {});
+}
+
+LveRenderGraph::ResourceId
+LveRenderGraph::addResource(const std::string &name, ResourceKind kind,
+                            const ImageDesc &desc) {
+  Resource resource{};
+  resource.name = name;
+  resource.kind = kind;
+  resource.desc = desc;
+  resources.push_back(resource);
+  compiled = false;
+  return static_cast<ResourceId>(resources.size() - 1);
+}
+
+LveRenderGraph::PassBuilder LveRenderGraph::addPass(const std::string &name,
+                                                    ExecuteFn execute) {
+  Pass pass{};
+  pass.name = name;
+  pass.execute = std::move(execute);
+  passes.push_back(std::move(pass));
+  compiled = false;
+  return PassBuilder{*this, static_cast<PassId>(passes.size() - 1)};
+}
+
+void LveRenderGraph::addAccess(PassId pass, ResourceId resource, Usage usage,
+                               VkPipelineStageFlags stages,
+                               VkAttachmentLoadOp loadOp,
+                               VkClearValue clearValue) {
+  assert(resource < resources.size() && "unknown render graph resource");
+  Access access{};
+  access.resource = resource;
+  access.usage = usage;
+  access.stages = stages;
+  access.loadOp = loadOp;
+  access.clearValue = clearValue;
+  passes[pass].accesses.push_back(access);
+  resources[resource].usage |= usageInfo(usage).imageUsage;
+  compiled = false;
+}
+
+bool LveRenderGraph::isRasterPass(const Pass &pass) const {
+  for (const auto &access : pass.accesses) {
+    if (isAttachment(access.usage)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void LveRenderGraph::compile() {
+  destroyFramebuffers();
+  destroyRenderPasses();
+  destroyTransientImages();
+
+  dynamicRendering = lveRenderer.usesDynamicRendering();
+  for (auto &resource : resources) {
+    if (resource.kind == ResourceKind::SwapChainImage) {
+      resource.desc.format = lveRenderer.getSwapChainImageFormat();
+    } else if (resource.kind == ResourceKind::SwapChainDepth) {
+      resource.desc.format = lveRenderer.getSwapChainDepthFormat();
+    }
+  }
+
+  cullPasses();
+  computeLifetimes();
+  planBarriers();
+  if (!dynamicRendering) {
+    createRenderPasses();
+  }
+  createTransientImages();
+
+  compiledTargetVersion = lveRenderer.getPipelineTargetVersion();
+  compiledGeneration = lveRenderer.getSwapChainGeneration();
+  compiled = true;
+
+  size_t culledCount = std::count_if(passes.begin(), passes.end(),
+                                     [](const Pass &pass) {
+                                       return pass.culled;
+                                     });
+  size_t transientCount = 0;
+  for (auto &block : memoryBlocks) {
+    transientCount += block.residents.size();
+  }
+  double mb = 1024.0 * 1024.0;
+  std::cout << "render graph: " << passes.size() - culledCount << " of "
+            << passes.size() << " passes, " << transientCount
+            << " transient images in " << memoryBlocks.size()
+            << " allocations, " << static_cast<double>(aliasedBytes) / mb
+            << " MB instead of " << static_cast<double>(transientBytes) / mb
+            << " MB per frame in flight" << std::endl;
+}
+
+void LveRenderGraph::reset() {
+  destroyFramebuffers();
+  destroyRenderPasses();
+  destroyTransientImages();
+  passes.clear();
+  resources.clear();
+  finalBarriers.clear();
+  memoryBlocks.clear();
+  compiled = false;
+}
+
+// Reference counting from the outputs backwards: a pass survives while a
+// live pass reads what it wrote, the swap chain image counts as read by the
+// presentation engine. A read depends on the last earlier write of the
+// image only, so a pass that loads its own output does not keep itself
+// alive.
+void LveRenderGraph::cullPasses() {
+  std::vector<uint32_t> passRefs(passes.size(), 0);
+  // for each pass, the writers of the images it reads
+  std::vector<std::vector<PassId>> producers(passes.size());
+  std::vector<PassId> lastWriters(resources.size(), NO_PASS);
+
+  for (PassId pass = 0; pass < passes.size(); pass++) {
+    passes[pass].culled = false;
+    for (const auto &access : passes[pass].accesses) {
+      PassId producer = lastWriters[access.resource];
+      if (readsImage(access.usage, access.loadOp) && producer != NO_PASS) {
+        producers[pass].push_back(producer);
+        passRefs[producer]++;
+      }
+    }
+    for (const auto &access : passes[pass].accesses) {
+      if (usageInfo(access.usage).write) {
+        lastWriters[access.resource] = pass;
+        if (resources[access.resource].kind == ResourceKind::SwapChainImage) {
+          passRefs[pass]++;
+        }
+      }
+    }
+    if (passes[pass].sideEffects) {
+      passRefs[pass]++;
+    }
+  }
+
+  // producers come first, so one sweep from the back releases everything a
+  // culled pass kept alive before it is looked at
+  for (PassId pass = static_cast<PassId>(passes.size()); pass-- > 0;) {
+    if (passRefs[pass] == 0) {
+      passes[pass].culled = true;
+      for (PassId producer : producers[pass]) {
+        passRefs[producer]--;
+      }
+    }
+  }
+}
+
+void LveRenderGraph::computeLifetimes() {
+  for (auto &resource : resources) {
+    resource.firstPass = NO_PASS;
+    resource.lastPass = NO_PASS;
+  }
+  for (uint32_t pass = 0; pass < passes.size(); pass++) {
+    if (passes[pass].culled) {
+      continue;
+    }
+    for (const auto &access : passes[pass].accesses) {
+      Resource &resource = resources[access.resource];
+      if (resource.firstPass == NO_PASS) {
+        resource.firstPass = pass;
+      }
+      resource.lastPass = pass;
+    }
+  }
+}
+
+void LveRenderGraph::planBarriers() {
+  struct State {
+    bool used = false;
+    VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+    VkPipelineStageFlags writeStages = 0;
+    VkAccessFlags writeAccess = 0;
+    // reads since the last write that a barrier already covers
+    VkPipelineStageFlags readStages = 0;
+  };
+  std::vector<State> states(resources.size());
+  for (auto &resource : resources) {
+    resource.firstBarrierPass = NO_PASS;
+  }
+
+  for (uint32_t passIndex = 0; passIndex < passes.size(); passIndex++) {
+    Pass &pass = passes[passIndex];
+    pass.barriers.clear();
+    if (pass.culled) {
+      continue;
+    }
+    for (auto &access : pass.accesses) {
+      Resource &resource = resources[access.resource];
+      State &state = states[access.resource];
+      UsageInfo info = usageInfo(access.usage);
+      bool reads = readsImage(access.usage, access.loadOp);
+      VkAccessFlags accessMask = info.access;
+      if (access.usage == Usage::ColorAttachment && reads) {
+        accessMask |= VK_ACCESS_COLOR_ATTACHMENT_READ_BIT;
+      }
+
+      Barrier barrier{access.resource, state.layout, info.layout, 0,
+                      access.stages, 0, accessMask};
+      if (!state.used) {
+        if (!info.write) {
+          throw std::runtime_error("render graph pass '" + pass.name +
+                                   "' reads '" + resource.name +
+                                   "' before anything wrote it!");
+        }
+        // the acquire semaphore is waited on at color attachment output,
+        // other images get their source scope once memory is assigned
+        barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        if (resource.kind == ResourceKind::SwapChainImage) {
+          barrier.srcStages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        } else {
+          resource.firstBarrierPass = passIndex;
+          resource.firstBarrierIndex =
+              static_cast<uint32_t>(pass.barriers.size());
+        }
+        pass.barriers.push_back(barrier);
+      } else if (info.write || info.layout != state.layout) {
+        barrier.srcStages = state.writeStages | state.readStages;
+        barrier.srcAccess = state.writeAccess;
+        pass.barriers.push_back(barrier);
+        state.readStages = 0;
+      } else if ((access.stages & ~state.readStages) != 0) {
+        barrier.srcStages = state.writeStages;
+        barrier.srcAccess = state.writeAccess;
+        pass.barriers.push_back(barrier);
+      }
+
+      if (info.write) {
+        state.writeStages = access.stages;
+        state.writeAccess = accessMask & ~(VK_ACCESS_COLOR_ATTACHMENT_READ_BIT |
+                                           VK_ACCESS_SHADER_READ_BIT |
+                                           VK_ACCESS_TRANSFER_READ_BIT);
+        state.readStages = reads ? access.stages : 0;
+      } else {
+        if (info.layout != state.layout) {
+          // later readers have to wait for the layout transition
+          state.writeStages = access.stages;
+          state.writeAccess = 0;
+        }
+        state.readStages |= access.stages;
+      }
+      state.layout = info.layout;
+      state.used = true;
+    }
+  }
+
+  finalBarriers.clear();
+  for (ResourceId id = 0; id < resources.size(); id++) {
+    Resource &resource = resources[id];
+    State &state = states[id];
+    resource.lastStages = state.writeStages | state.readStages;
+    resource.lastWriteAccess = state.writeAccess;
+    if (!state.used || resource.kind != ResourceKind::SwapChainImage) {
+      continue;
+    }
+    // what the swap chain render pass' finalLayout did
+    Barrier barrier{id,
+                    state.layout,
+                    VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+                    resource.lastStages,
+                    VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                    state.writeAccess,
+                    0};
+    if (lveRenderer.isHeadless()) {
+      barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+      barrier.dstStages = VK_PIPELINE_STAGE_TRANSFER_BIT;
+      barrier.dstAccess = VK_ACCESS_TRANSFER_READ_BIT;
+    }
+    finalBarriers.push_back(barrier);
+  }
+
+  // until memory is shared the previous user is the image itself, one frame
+  // in flight earlier
+  for (auto &resource : resources) {
+    if (resource.firstBarrierPass != NO_PASS) {
+      Barrier &barrier = passes[resource.firstBarrierPass]
+                             .barriers[resource.firstBarrierIndex];
+      barrier.srcStages = resource.lastStages;
+      barrier.srcAccess = resource.lastWriteAccess;
+    }
+  }
+
+  // attachments nothing reads afterwards are not written back
+  for (uint32_t passIndex = 0; passIndex < passes.size(); passIndex++) {
+    if (passes[passIndex].culled) {
+      continue;
+    }
+    for (auto &access : passes[passIndex].accesses) {
+      bool readLater =
+          resources[access.resource].kind == ResourceKind::SwapChainImage;
+      for (uint32_t later = passIndex + 1;
+           later < passes.size() && !readLater; later++) {
+        if (passes[later].culled) {
+          continue;
+        }
+        for (const auto &laterAccess : passes[later].accesses) {
+          if (laterAccess.resource == access.resource &&
+              readsImage(laterAccess.usage, laterAccess.loadOp)) {
+            readLater = true;
+          }
+        }
+      }
+      access.storeOp = readLater ? VK_ATTACHMENT_STORE_OP_STORE
+                                 : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    }
+  }
+}
+
+void LveRenderGraph::createRenderPasses() {
+  for (auto &pass : passes) {
+    if (pass.culled || !isRasterPass(pass)) {
+      continue;
+    }
+
+    // layouts are left to the graph's barriers, the render pass neither
+    // transitions nor needs external dependencies
+    std::vector<VkAttachmentDescription> attachments;
+    VkAttachmentReference colorRef{};
+    VkAttachmentReference depthRef{};
+    bool hasColor = false;
+    bool hasDepth = false;
+    for (const auto &access : pass.accesses) {
+      if (!isAttachment(access.usage)) {
+        continue;
+      }
+      VkFormat format = resources[access.resource].desc.format;
+      VkImageLayout layout = usageInfo(access.usage).layout;
+
+      VkAttachmentDescription attachment{};
+      attachment.format = format;
+      attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+      attachment.loadOp = access.loadOp;
+      attachment.storeOp = access.storeOp;
+      attachment.stencilLoadOp = hasStencilComponent(format)
+                                     ? access.loadOp
+                                     : VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+      attachment.stencilStoreOp = hasStencilComponent(format)
+                                      ? access.storeOp
+                                      : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+      attachment.initialLayout = layout;
+      attachment.finalLayout = layout;
+
+      VkAttachmentReference reference{
+          static_cast<uint32_t>(attachments.size()), layout};
+      if (access.usage == Usage::ColorAttachment) {
+        colorRef = reference;
+        hasColor = true;
+      } else {
+        depthRef = reference;
+        hasDepth = true;
+      }
+      attachments.push_back(attachment);
+    }
+
+    VkSubpassDescription subpass{};
+    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpass.colorAttachmentCount = hasColor ? 1 : 0;
+    subpass.pColorAttachments = hasColor ? &colorRef : nullptr;
+    subpass.pDepthStencilAttachment = hasDepth ? &depthRef : nullptr;
+
+    VkRenderPassCreateInfo renderPassInfo{};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+    renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+    renderPassInfo.pAttachments = attachments.data();
+    renderPassInfo.subpassCount = 1;
+    renderPassInfo.pSubpasses = &subpass;
+
+    if (vkCreateRenderPass(lveDevice.device(), &renderPassInfo,
+                           lveDevice.allocator(),
+                           &pass.renderPass) != VK_SUCCESS) {
+      throw std::runtime_error("failed to create render graph render pass!");
+    }
+  }
+}
+
+void LveRenderGraph::createTransientImages() {
+  std::vector<ResourceId> transients;
+  for (ResourceId id = 0; id < resources.size(); id++) {
+    if (resources[id].kind == ResourceKind::Transient &&
+        resources[id].firstPass != NO_PASS) {
+      transients.push_back(id);
+    }
+  }
+  transientExtent = lveRenderer.getSwapChainExtent();
+  transientSets.resize(lveRenderer.getFramesInFlight());
+
+  VkDevice device = lveDevice.device();
+  for (auto &set : transientSets) {
+    set.images.assign(resources.size(), VK_NULL_HANDLE);
+    set.imageViews.assign(resources.size(), VK_NULL_HANDLE);
+    for (ResourceId id : transients) {
+      const Resource &resource = resources[id];
+      VkExtent2D extent = resolveExtent(resource);
+
+      VkImageCreateInfo imageInfo{};
+      imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+      imageInfo.imageType = VK_IMAGE_TYPE_2D;
+      imageInfo.extent = {extent.width, extent.height, 1};
+      imageInfo.mipLevels = 1;
+      imageInfo.arrayLayers = 1;
+      imageInfo.format = resource.desc.format;
+      imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+      imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+      imageInfo.usage = resource.usage;
+      imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+      imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+      if (vkCreateImage(device, &imageInfo, lveDevice.allocator(),
+                        &set.images[id]) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create render graph image!");
+      }
+    }
+  }
+
+  // Largest first, each image goes into the first allocation whose images
+  // are all done before it starts or start after it is done. Images of one
+  // frame in flight never share memory with another's.
+  std::vector<VkMemoryRequirements> requirements(resources.size());
+  for (ResourceId id : transients) {
+    vkGetImageMemoryRequirements(device, transientSets[0].images[id],
+                                 &requirements[id]);
+  }
+  std::sort(transients.begin(), transients.end(),
+            [&](ResourceId a, ResourceId b) {
+              return requirements[a].size > requirements[b].size;
+            });
+  memoryBlocks.clear();
+  transientBytes = 0;
+  for (ResourceId id : transients) {
+    Resource &resource = resources[id];
+    transientBytes += requirements[id].size;
+    uint32_t blockIndex = 0;
+    for (; blockIndex < memoryBlocks.size(); blockIndex++) {
+      const MemoryBlock &block = memoryBlocks[blockIndex];
+      if ((block.memoryTypeBits & requirements[id].memoryTypeBits) == 0) {
+        continue;
+      }
+      bool overlaps = false;
+      for (ResourceId resident : block.residents) {
+        overlaps |= resources[resident].firstPass <= resource.lastPass &&
+                    resource.firstPass <= resources[resident].lastPass;
+      }
+      if (!overlaps) {
+        break;
+      }
+    }
+    if (blockIndex == memoryBlocks.size()) {
+      memoryBlocks.emplace_back();
+    }
+    MemoryBlock &block = memoryBlocks[blockIndex];
+    block.size = std::max(block.size, requirements[id].size);
+    block.memoryTypeBits &= requirements[id].memoryTypeBits;
+    block.residents.push_back(id);
+  }
+
+  // an image's first barrier waits for whatever used its memory last, in
+  // this frame or for the first image the last one of the previous frame
+  aliasedBytes = 0;
+  for (auto &block : memoryBlocks) {
+    aliasedBytes += block.size;
+    std::sort(block.residents.begin(), block.residents.end(),
+              [&](ResourceId a, ResourceId b) {
+                return resources[a].firstPass < resources[b].firstPass;
+              });
+    for (size_t i = 0; i < block.residents.size(); i++) {
+      const Resource &resource = resources[block.residents[i]];
+      const Resource &previous =
+          resources[block.residents[(i + block.residents.size() - 1) %
+                                    block.residents.size()]];
+      Barrier &barrier = passes[resource.firstBarrierPass]
+                             .barriers[resource.firstBarrierIndex];
+      barrier.srcStages = previous.lastStages;
+      barrier.srcAccess = previous.lastWriteAccess;
+    }
+  }
+
+  for (auto &set : transientSets) {
+    set.memory.assign(memoryBlocks.size(), VK_NULL_HANDLE);
+    for (size_t blockIndex = 0; blockIndex < memoryBlocks.size();
+         blockIndex++) {
+      const MemoryBlock &block = memoryBlocks[blockIndex];
+      VkMemoryAllocateInfo allocInfo{};
+      allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+      allocInfo.allocationSize = block.size;
+      allocInfo.memoryTypeIndex = lveDevice.findMemoryType(
+          block.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+      if (vkAllocateMemory(device, &allocInfo, lveDevice.allocator(),
+                           &set.memory[blockIndex]) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate render graph memory!");
+      }
+      for (ResourceId id : block.residents) {
+        if (vkBindImageMemory(device, set.images[id], set.memory[blockIndex],
+                              0) != VK_SUCCESS) {
+          throw std::runtime_error("failed to bind render graph memory!");
+        }
+      }
+    }
+
+    for (ResourceId id : transients) {
+      VkImageViewCreateInfo viewInfo{};
+      viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+      viewInfo.image = set.images[id];
+      viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+      viewInfo.format = resources[id].desc.format;
+      viewInfo.subresourceRange = {aspectMask(resources[id].desc.format), 0, 1,
+                                   0, 1};
+      if (vkCreateImageView(device, &viewInfo, lveDevice.allocator(),
+                            &set.imageViews[id]) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create render graph image view!");
+      }
+    }
+  }
+}
+
+void LveRenderGraph::destroyRenderPasses() {
+  VkDevice device = lveDevice.device();
+  const VkAllocationCallbacks *allocator = lveDevice.allocator();
+  for (auto &pass : passes) {
+    if (pass.renderPass == VK_NULL_HANDLE) {
+      continue;
+    }
+    lveDevice.deferDestruction(
+        [device, allocator, renderPass = pass.renderPass]() {
+          vkDestroyRenderPass(device, renderPass, allocator);
+        });
+    pass.renderPass = VK_NULL_HANDLE;
+  }
+}
+
+void LveRenderGraph::destroyFramebuffers() {
+  std::vector<VkFramebuffer> framebuffers;
+  for (auto &pass : passes) {
+    for (auto &entry : pass.framebuffers) {
+      framebuffers.push_back(entry.second);
+    }
+    pass.framebuffers.clear();
+  }
+  if (framebuffers.empty()) {
+    return;
+  }
+  VkDevice device = lveDevice.device();
+  const VkAllocationCallbacks *allocator = lveDevice.allocator();
+  lveDevice.deferDestruction(
+      [device, allocator, framebuffers = std::move(framebuffers)]() {
+        for (auto framebuffer : framebuffers) {
+          vkDestroyFramebuffer(device, framebuffer, allocator);
+        }
+      });
+}
+
+void LveRenderGraph::destroyTransientImages() {
+  VkDevice device = lveDevice.device();
+  const VkAllocationCallbacks *allocator = lveDevice.allocator();
+  for (auto &set : transientSets) {
+    lveDevice.deferDestruction([device, allocator, set = std::move(set)]() {
+      for (auto imageView : set.imageViews) {
+        if (imageView != VK_NULL_HANDLE) {
+          vkDestroyImageView(device, imageView, allocator);
+        }
+      }
+      for (auto image : set.images) {
+        if (image != VK_NULL_HANDLE) {
+          vkDestroyImage(device, image, allocator);
+        }
+      }
+      for (auto memory : set.memory) {
+        vkFreeMemory(device, memory, allocator);
+      }
+    });
+  }
+  transientSets.clear();
+}
+
+void LveRenderGraph::update() {
+  // new formats need new render passes and pipelines
+  if (lveRenderer.getPipelineTargetVersion() != compiledTargetVersion) {
+    compile();
+    return;
+  }
+  if (lveRenderer.getSwapChainGeneration() == compiledGeneration) {
+    return;
+  }
+  compiledGeneration = lveRenderer.getSwapChainGeneration();
+
+  // the old chain's image views are gone once its frames retire
+  destroyFramebuffers();
+  VkExtent2D extent = lveRenderer.getSwapChainExtent();
+  if (extent.width != transientExtent.width ||
+      extent.height != transientExtent.height ||
+      transientSets.size() != lveRenderer.getFramesInFlight()) {
+    destroyTransientImages();
+    createTransientImages();
+  }
+}
+
+VkExtent2D LveRenderGraph::resolveExtent(const Resource &resource) const {
+  if (resource.desc.extent.width == 0 || resource.desc.extent.height == 0) {
+    return lveRenderer.getSwapChainExtent();
+  }
+  return resource.desc.extent;
+}
+
+uint32_t LveRenderGraph::getMemoryBlock(ResourceId image) const {
+  for (uint32_t block = 0; block < memoryBlocks.size(); block++) {
+    const auto &residents = memoryBlocks[block].residents;
+    if (std::find(residents.begin(), residents.end(), image) !=
+        residents.end()) {
+      return block;
+    }
+  }
+  return NO_MEMORY_BLOCK;
+}
+
+VkImage LveRenderGraph::getImage(ResourceId image) const {
+  switch (resources[image].kind) {
+  case ResourceKind::SwapChainImage:
+    return lveRenderer.getSwapChainImage();
+  case ResourceKind::SwapChainDepth:
+    return lveRenderer.getDepthImage();
+  default:
+    return transientSets[lveRenderer.getFrameIndex()].images[image];
+  }
+}
+
+VkImageView LveRenderGraph::getImageView(ResourceId image) const {
+  switch (resources[image].kind) {
+  case ResourceKind::SwapChainImage:
+    return lveRenderer.getSwapChainImageView();
+  case ResourceKind::SwapChainDepth:
+    return lveRenderer.getDepthImageView();
+  default:
+    return transientSets[lveRenderer.getFrameIndex()].imageViews[image];
+  }
+}
+
+VkExtent2D LveRenderGraph::getExtent(ResourceId image) const {
+  return resolveExtent(resources[image]);
+}
+
+PipelineTargetInfo LveRenderGraph::getPipelineTarget(PassId pass) const {
+  assert(compiled && "render graph has to be compiled first");
+  PipelineTargetInfo target{};
+  if (!dynamicRendering) {
+    target.renderPass = passes[pass].renderPass;
+    return target;
+  }
+  for (const auto &access : passes[pass].accesses) {
+    VkFormat format = resources[access.resource].desc.format;
+    if (access.usage == Usage::ColorAttachment) {
+      target.colorFormat = format;
+    } else if (isAttachment(access.usage)) {
+      target.depthFormat = format;
+      if (hasStencilComponent(format)) {
+        target.stencilFormat = format;
+      }
+    }
+  }
+  return target;
+}
+
+VkFramebuffer LveRenderGraph::getFramebuffer(Pass &pass, VkExtent2D extent) {
+  viewScratch.clear();
+  for (const auto &access : pass.accesses) {
+    if (isAttachment(access.usage)) {
+      viewScratch.push_back(getImageView(access.resource));
+    }
+  }
+  auto it = pass.framebuffers.find(viewScratch);
+  if (it != pass.framebuffers.end()) {
+    return it->second;
+  }
+
+  VkFramebufferCreateInfo framebufferInfo{};
+  framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+  framebufferInfo.renderPass = pass.renderPass;
+  framebufferInfo.attachmentCount = static_cast<uint32_t>(viewScratch.size());
+  framebufferInfo.pAttachments = viewScratch.data();
+  framebufferInfo.width = extent.width;
+  framebufferInfo.height = extent.height;
+  framebufferInfo.layers = 1;
+
+  VkFramebuffer framebuffer;
+  if (vkCreateFramebuffer(lveDevice.device(), &framebufferInfo,
+                          lveDevice.allocator(),
+                          &framebuffer) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create render graph framebuffer!");
+  }
+  pass.framebuffers.emplace(viewScratch, framebuffer);
+  return framebuffer;
+}
+
+void LveRenderGraph::beginRendering(VkCommandBuffer commandBuffer,
+                                    PassId passId, VkExtent2D extent,
+                                    VkExtent2D renderArea) {
+  Pass &pass = passes[passId];
+  VkSubpassContents contents =
+      pass.secondaryCommandBuffers
+          ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS
+          : VK_SUBPASS_CONTENTS_INLINE;
+  if (dynamicRendering) {
+    VkRenderingAttachmentInfo colorAttachment{};
+    VkRenderingAttachmentInfo depthAttachment{};
+    bool hasColor = false;
+    bool hasDepth = false;
+    bool hasStencil = false;
+    for (const auto &access : pass.accesses) {
+      if (!isAttachment(access.usage)) {
+        continue;
+      }
+      VkRenderingAttachmentInfo &attachment =
+          access.usage == Usage::ColorAttachment ? colorAttachment
+                                                 : depthAttachment;
+      attachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+      attachment.imageView = getImageView(access.resource);
+      attachment.imageLayout = usageInfo(access.usage).layout;
+      attachment.loadOp = access.loadOp;
+      attachment.storeOp = access.storeOp;
+      attachment.clearValue = access.clearValue;
+      if (access.usage == Usage::ColorAttachment) {
+        hasColor = true;
+      } else {
+        hasDepth = true;
+        hasStencil =
+            hasStencilComponent(resources[access.resource].desc.format);
+      }
+    }
+
+    VkRenderingInfo renderingInfo{};
+    renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+    if (contents == VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS) {
+      renderingInfo.flags = VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT;
+    }
+    renderingInfo.renderArea.offset = {0, 0};
+    renderingInfo.renderArea.extent = renderArea;
+    renderingInfo.layerCount = 1;
+    renderingInfo.colorAttachmentCount = hasColor ? 1 : 0;
+    renderingInfo.pColorAttachments = hasColor ? &colorAttachment : nullptr;
+    renderingInfo.pDepthAttachment = hasDepth ? &depthAttachment : nullptr;
+    renderingInfo.pStencilAttachment = hasStencil ? &depthAttachment : nullptr;
+
+    lveDevice.cmdBeginRendering(commandBuffer, &renderingInfo);
+    lveRenderer.setRenderTarget(getPipelineTarget(passId), VK_NULL_HANDLE,
+                                renderArea);
+  } else {
+    clearValueScratch.clear();
+    for (const auto &access : pass.accesses) {
+      if (isAttachment(access.usage)) {
+        clearValueScratch.push_back(access.clearValue);
+      }
+    }
+
+    VkRenderPassBeginInfo renderPassInfo{};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    renderPassInfo.renderPass = pass.renderPass;
+    renderPassInfo.framebuffer = getFramebuffer(pass, extent);
+    renderPassInfo.renderArea.offset = {0, 0};
+    renderPassInfo.renderArea.extent = renderArea;
+    renderPassInfo.clearValueCount =
+        static_cast<uint32_t>(clearValueScratch.size());
+    renderPassInfo.pClearValues = clearValueScratch.data();
+
+    vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, contents);
+    lveRenderer.setRenderTarget(getPipelineTarget(passId),
+                                renderPassInfo.framebuffer, renderArea);
+  }
+
+  // secondary buffers set their own dynamic state
+  if (contents == VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS) {
+    return;
+  }
+  VkViewport viewport{};
+  viewport.x = 0.0f;
+  viewport.y = 0.0f;
+  viewport.width = static_cast<float>(renderArea.width);
+  viewport.height = static_cast<float>(renderArea.height);
+  viewport.minDepth = 0.0f;
+  viewport.maxDepth = 1.0f;
+  VkRect2D scissor{{0, 0}, renderArea};
+  vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+  vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+}
+
+void LveRenderGraph::recordBarriers(VkCommandBuffer commandBuffer,
+                                    const std::vector<Barrier> &barriers) {
+  if (barriers.empty()) {
+    return;
+  }
+  barrierScratch.clear();
+  VkPipelineStageFlags srcStages = 0;
+  VkPipelineStageFlags dstStages = 0;
+  for (const auto &barrier : barriers) {
+    VkImageMemoryBarrier imageBarrier{};
+    imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    imageBarrier.srcAccessMask = barrier.srcAccess;
+    imageBarrier.dstAccessMask = barrier.dstAccess;
+    imageBarrier.oldLayout = barrier.oldLayout;
+    imageBarrier.newLayout = barrier.newLayout;
+    imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    imageBarrier.image = getImage(barrier.resource);
+    imageBarrier.subresourceRange = {
+        aspectMask(resources[barrier.resource].desc.format), 0, 1, 0, 1};
+    barrierScratch.push_back(imageBarrier);
+    srcStages |= barrier.srcStages;
+    dstStages |= barrier.dstStages;
+  }
+  if (srcStages == 0) {
+    srcStages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+  }
+  vkCmdPipelineBarrier(commandBuffer, srcStages, dstStages, 0, 0, nullptr, 0,
+                       nullptr, static_cast<uint32_t>(barrierScratch.size()),
+                       barrierScratch.data());
+}
+
+void LveRenderGraph::execute(VkCommandBuffer commandBuffer) {
+  assert(compiled && "render graph has to be compiled before it is executed");
+  update();
+
+  LveGpuProfiler &profiler = lveRenderer.getGpuProfiler();
+  for (PassId passId = 0; passId < passes.size(); passId++) {
+    Pass &pass = passes[passId];
+    if (pass.culled) {
+      continue;
+    }
+    uint32_t scope = profiler.beginScope(commandBuffer, pass.name);
+    recordBarriers(commandBuffer, pass.barriers);
+    if (!isRasterPass(pass)) {
+      pass.execute(commandBuffer);
+      profiler.endScope(commandBuffer, scope);
+      continue;
+    }
+
+    VkExtent2D extent{};
+    for (const auto &access : pass.accesses) {
+      if (isAttachment(access.usage)) {
+        extent = resolveExtent(resources[access.resource]);
+        break;
+      }
+    }
+    // framebuffers cover the whole image so a new scale needs no new one
+    VkExtent2D renderArea =
+        pass.dynamicResolution ? lveRenderer.getRenderExtent() : extent;
+    beginRendering(commandBuffer, passId, extent, renderArea);
+    pass.execute(commandBuffer);
+    if (dynamicRendering) {
+      lveDevice.cmdEndRendering(commandBuffer);
+    } else {
+      vkCmdEndRenderPass(commandBuffer);
+    }
+    profiler.endScope(commandBuffer, scope);
+  }
+  recordBarriers(commandBuffer, finalBarriers);
+}
+
+} // namespace lve
@@ -0,0 +1,244 @@
+#pragma once
+
+#include "lve_device.hpp"
+#include "lve_pipeline.hpp"
+#include "lve_renderer.hpp"
+
+// std
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace lve {
+
+// Passes of a frame declared by the images they read and write, recorded in
+// declaration order. compile() drops passes whose output nothing consumes,
+// plans the barriers between the remaining ones and places transient images
+// with disjoint lifetimes in the same memory. Raster passes are begun and
+// ended by the graph, with dynamic rendering when the swap chain uses it and
+// with one render pass per graph pass otherwise.
+class LveRenderGraph {
+public:
+  using ResourceId = uint32_t;
+  using PassId = uint32_t;
+  using ExecuteFn = std::function<void(VkCommandBuffer)>;
+
+  // how a pass uses an image, decides its layout, stages and access
+  enum class Usage {
+    ColorAttachment,
+    DepthAttachment,
+    // depth tested without writes
+    DepthReadOnly,
+    Sampled,
+    TransferSrc,
+    TransferDst,
+  };
+
+  struct Barrier {
+    ResourceId resource;
+    VkImageLayout oldLayout;
+    VkImageLayout newLayout;
+    VkPipelineStageFlags srcStages;
+    VkPipelineStageFlags dstStages;
+    VkAccessFlags srcAccess;
+    VkAccessFlags dstAccess;
+  };
+
+  struct ImageDesc {
+    VkFormat format = VK_FORMAT_UNDEFINED;
+    // a zero extent follows the swap chain
+    VkExtent2D extent{0, 0};
+  };
+
+  // A raster pass has at most one color attachment, as pipelines only
+  // describe one.
+  class PassBuilder {
+  public:
+    // LOAD keeps what earlier passes wrote, and makes this pass read it
+    PassBuilder &writeColor(ResourceId image, VkAttachmentLoadOp loadOp,
+                            VkClearColorValue clearValue = {});
+    PassBuilder &writeDepth(ResourceId image, VkAttachmentLoadOp loadOp,
+                            float clearDepth = 1.0f);
+    PassBuilder &readDepth(ResourceId image);
+    PassBuilder &
+    sample(ResourceId image,
+           VkPipelineStageFlags stages = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+    PassBuilder &copyFrom(ResourceId image);
+    PassBuilder &copyTo(ResourceId image);
+    // never culled, even when nothing reads what it writes
+    PassBuilder &setSideEffects();
+    // the pass records into secondary command buffers through
+    // LveRenderer::recordParallel
+    PassBuilder &setSecondaryCommandBuffers();
+    // renders only the top left LveRenderer::getRenderExtent() of its
+    // attachments
+    PassBuilder &setDynamicResolution();
+
+    PassId getId() const { return pass; }
+
+  private:
+    friend class LveRenderGraph;
+    PassBuilder(LveRenderGraph &graph, PassId pass)
+        : graph{graph}, pass{pass} {}
+
+    LveRenderGraph &graph;
+    PassId pass;
+  };
+
+  LveRenderGraph(LveDevice &device, LveRenderer &renderer);
+  ~LveRenderGraph();
+
+  LveRenderGraph(const LveRenderGraph &) = delete;
+  LveRenderGraph &operator=(const LveRenderGraph &) = delete;
+
+  static constexpr uint32_t NO_MEMORY_BLOCK = UINT32_MAX;
+
+  // allocated by the graph, one set per frame in flight
+  ResourceId createImage(const std::string &name, const ImageDesc &desc);
+  // the image acquired for the current frame, left ready to be presented or
+  // captured after the last pass
+  ResourceId importSwapChainImage(const std::string &name);
+  // the swap chain's depth attachment of the current frame in flight, only
+  // usable as an attachment and not kept past the frame
+  ResourceId importSwapChainDepth(const std::string &name);
+
+  PassBuilder addPass(const std::string &name, ExecuteFn execute);
+
+  // Has to be called after the graph was declared or changed. The graph
+  // recompiles itself when the swap chain formats change and reallocates its
+  // images when the extent or frames in flight do.
+  void compile();
+  // drops every pass and resource, the graph has to be declared again
+  void reset();
+
+  // records every pass that survived culling, between the renderer's
+  // beginFrame and endFrame
+  void execute(VkCommandBuffer commandBuffer);
+
+  // what a raster pass' pipelines are built against, after compile()
+  PipelineTargetInfo getPipelineTarget(PassId pass) const;
+  bool isCulled(PassId pass) const { return passes[pass].culled; }
+  // recorded before the pass, after compile()
+  const std::vector<Barrier> &getBarriers(PassId pass) const {
+    return passes[pass].barriers;
+  }
+  // Transient images in the same allocation alias each other, all of them
+  // at offset 0. NO_MEMORY_BLOCK for imported and culled away images.
+  uint32_t getMemoryBlock(ResourceId image) const;
+  size_t getMemoryBlockCount() const { return memoryBlocks.size(); }
+
+  // valid while the pass using them executes
+  VkImage getImage(ResourceId image) const;
+  VkImageView getImageView(ResourceId image) const;
+  VkExtent2D getExtent(ResourceId image) const;
+
+private:
+  static constexpr uint32_t NO_PASS = UINT32_MAX;
+
+  enum class ResourceKind { Transient, SwapChainImage, SwapChainDepth };
+
+  struct Resource {
+    std::string name;
+    ResourceKind kind;
+    ImageDesc desc;
+    VkImageUsageFlags usage = 0;
+    // first and last pass using it, NO_PASS when culled away
+    uint32_t firstPass = NO_PASS;
+    uint32_t lastPass = NO_PASS;
+    // the barrier of its first use waits on the previous user of its memory
+    uint32_t firstBarrierPass = NO_PASS;
+    uint32_t firstBarrierIndex = 0;
+    VkPipelineStageFlags lastStages = 0;
+    VkAccessFlags lastWriteAccess = 0;
+  };
+
+  struct Access {
+    ResourceId resource;
+    Usage usage;
+    VkPipelineStageFlags stages;
+    VkAttachmentLoadOp loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    // compiled, DONT_CARE when no later pass reads the attachment
+    VkAttachmentStoreOp storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    VkClearValue clearValue{};
+  };
+
+  struct Pass {
+    std::string name;
+    ExecuteFn execute;
+    std::vector<Access> accesses;
+    bool sideEffects = false;
+    bool secondaryCommandBuffers = false;
+    bool dynamicResolution = false;
+
+    bool culled = false;
+    std::vector<Barrier> barriers;
+    VkRenderPass renderPass = VK_NULL_HANDLE;
+    // keyed by attachment views, swap chain images change every frame
+    std::map<std::vector<VkImageView>, VkFramebuffer> framebuffers;
+  };
+
+  // images that share one allocation, in order of first use
+  struct MemoryBlock {
+    VkDeviceSize size = 0;
+    uint32_t memoryTypeBits = ~0u;
+    std::vector<ResourceId> residents;
+  };
+
+  struct TransientSet {
+    std::vector<VkImage> images;
+    std::vector<VkImageView> imageViews;
+    std::vector<VkDeviceMemory> memory;
+  };
+
+  bool isRasterPass(const Pass &pass) const;
+  ResourceId addResource(const std::string &name, ResourceKind kind,
+                         const ImageDesc &desc);
+  void addAccess(PassId pass, ResourceId resource, Usage usage,
+                 VkPipelineStageFlags stages, VkAttachmentLoadOp loadOp,
+                 VkClearValue clearValue);
+
+  void cullPasses();
+  void computeLifetimes();
+  void planBarriers();
+  void createRenderPasses();
+  void createTransientImages();
+  void destroyRenderPasses();
+  void destroyFramebuffers();
+  void destroyTransientImages();
+  // keeps images, framebuffers and render passes in line with the swap chain
+  void update();
+
+  VkExtent2D resolveExtent(const Resource &resource) const;
+  VkFramebuffer getFramebuffer(Pass &pass, VkExtent2D extent);
+  void beginRendering(VkCommandBuffer commandBuffer, PassId pass,
+                      VkExtent2D extent, VkExtent2D renderArea);
+  void recordBarriers(VkCommandBuffer commandBuffer,
+                      const std::vector<Barrier> &barriers);
+
+  LveDevice &lveDevice;
+  LveRenderer &lveRenderer;
+
+  std::vector<Resource> resources;
+  std::vector<Pass> passes;
+  std::vector<Barrier> finalBarriers;
+  std::vector<MemoryBlock> memoryBlocks;
+  std::vector<TransientSet> transientSets;
+
+  bool compiled = false;
+  bool dynamicRendering = false;
+  uint32_t compiledTargetVersion = 0;
+  uint32_t compiledGeneration = 0;
+  VkExtent2D transientExtent{0, 0};
+  // per frame in flight, with and without aliasing
+  VkDeviceSize transientBytes = 0;
+  VkDeviceSize aliasedBytes = 0;
+
+  // reused every frame so recording does not allocate
+  std::vector<VkImageMemoryBarrier> barrierScratch;
+  std::vector<VkImageView> viewScratch;
+  std::vector<VkClearValue> clearValueScratch;
+};
+
+} // namespace lve
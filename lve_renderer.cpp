@@ -12,13 +12,26 @@
 
 namespace lve {
 
-LveRenderer::LveRenderer(LveWindow &window, LveDevice &device)
-    : lveWindow{window}, lveDevice{device} {
+static bool hasStencilComponent(VkFormat format) {
+  return format == VK_FORMAT_D32_SFLOAT_S8_UINT ||
+         format == VK_FORMAT_D24_UNORM_S8_UINT;
+}
+
+LveRenderer::LveRenderer(LveWindow &window, LveDevice &device,
+                         LveThreadPool &threadPool,
+                         VkPresentModeKHR presentMode, uint32_t framesInFlight)
+    : lveWindow{window}, lveDevice{device}, threadPool{threadPool},
+      gpuProfiler{device, framesInFlight}, presentMode{presentMode},
+      framesInFlight{framesInFlight} {
   recreateSwapChain();
   createCommandBuffers();
+  createRecordingContexts();
 }
 
-LveRenderer::~LveRenderer() { freeCommandBuffers(); }
+LveRenderer::~LveRenderer() {
+  destroyRecordingContexts();
+  freeCommandBuffers();
+}
 
 void LveRenderer::recreateSwapChain() {
   auto extent = lveWindow.getExtent();
@@ -26,23 +39,124 @@ void LveRenderer::recreateSwapChain() {
     extent = lveWindow.getExtent();
     glfwWaitEvents();
   }
+  swapChainGeneration++;
 
-  vkDeviceWaitIdle(lveDevice.device());
-
+  // no device idle, the old chain is handed to vkCreateSwapchainKHR and
+  // destroyed once its last frame has retired
   if (lveSwapChain == nullptr) {
-    lveSwapChain = std::make_unique<LveSwapChain>(lveDevice, extent);
+    lveSwapChain = std::make_unique<LveSwapChain>(lveDevice, extent,
+                                                  presentMode, framesInFlight);
   } else {
     std::shared_ptr<LveSwapChain> oldSwapChain = std::move(lveSwapChain);
-    lveSwapChain =
-        std::make_unique<LveSwapChain>(lveDevice, extent, oldSwapChain);
+    lveSwapChain = std::make_unique<LveSwapChain>(
+        lveDevice, extent, presentMode, framesInFlight, oldSwapChain);
     if (!oldSwapChain->compareSwapFormats(*lveSwapChain.get())) {
-      throw std::runtime_error("Swap chain Image or depth format has changed");
+      // pipelines have to be rebuilt against getPipelineTarget()
+      pipelineTargetVersion++;
+    }
+  }
+
+  upscaleFilter = lveDevice.supportsFormatFeatures(
+                      lveSwapChain->getSwapChainImageFormat(),
+                      VK_IMAGE_TILING_OPTIMAL,
+                      VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT)
+                      ? VK_FILTER_LINEAR
+                      : VK_FILTER_NEAREST;
+  // a new format the graph could not upscale renders at full size
+  if (dynamicResolutionEnabled && !supportsDynamicResolution()) {
+    dynamicResolutionEnabled = false;
+  }
+}
+
+void LveRenderer::setPresentMode(VkPresentModeKHR presentMode) {
+  if (presentMode == this->presentMode) {
+    return;
+  }
+  this->presentMode = presentMode;
+  presentModeChanged = true;
+}
+
+void LveRenderer::setFramesInFlight(uint32_t framesInFlight) {
+  assert(!isFrameStarted &&
+         "cannot change frames in flight while a frame is in progress");
+  framesInFlight = std::clamp<uint32_t>(framesInFlight, 1,
+                                        LveSwapChain::MAX_FRAMES_IN_FLIGHT);
+  if (framesInFlight == this->framesInFlight) {
+    return;
+  }
+  this->framesInFlight = framesInFlight;
+
+  // primary command buffers are freed directly, nothing may still use them
+  lveDevice.waitIdle();
+  destroyRecordingContexts();
+  freeCommandBuffers();
+  recreateSwapChain();
+  gpuProfiler.setFrameCount(framesInFlight);
+  createCommandBuffers();
+  createRecordingContexts();
+  currentFrameIndex = 0;
+}
+
+void LveRenderer::enableFrameCapture(uint32_t slotCount,
+                                     LveFrameCapture::Callback callback) {
+  // presentable images are neither transfer sources nor left in a layout
+  // the copy can read
+  if (!lveSwapChain->isHeadless()) {
+    throw std::runtime_error("frame capture requires headless rendering!");
+  }
+  frameCapture = std::make_unique<LveFrameCapture>(lveDevice, slotCount,
+                                                   std::move(callback));
+}
+
+bool LveRenderer::supportsDynamicResolution() const {
+  // the scene color image has the swap chain format
+  return lveSwapChain->isBlitTarget() &&
+         lveDevice.supportsFormatFeatures(
+             lveSwapChain->getSwapChainImageFormat(), VK_IMAGE_TILING_OPTIMAL,
+             VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT);
+}
+
+void LveRenderer::setDynamicResolution(bool enabled) {
+  if (enabled && !supportsDynamicResolution()) {
+    throw std::runtime_error(
+        "dynamic resolution requires a swap chain format that can be blitted "
+        "from and to!");
+  }
+  dynamicResolutionEnabled = enabled;
+}
+
+void LveRenderer::recordUpscale(VkCommandBuffer commandBuffer,
+                                VkImage source) {
+  VkExtent2D extent = lveSwapChain->getSwapChainExtent();
+  VkImageBlit blit{};
+  blit.srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+  blit.srcOffsets[1] = {static_cast<int32_t>(renderExtent.width),
+                        static_cast<int32_t>(renderExtent.height), 1};
+  blit.dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+  blit.dstOffsets[1] = {static_cast<int32_t>(extent.width),
+                        static_cast<int32_t>(extent.height), 1};
+  vkCmdBlitImage(commandBuffer, source, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                 lveSwapChain->getImage(currentImageIndex),
+                 VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit,
+                 upscaleFilter);
+}
+
+PipelineTargetInfo LveRenderer::getPipelineTarget() const {
+  PipelineTargetInfo target{};
+  if (lveSwapChain->usesDynamicRendering()) {
+    target.colorFormat = lveSwapChain->getSwapChainImageFormat();
+    target.depthFormat = lveSwapChain->getSwapChainDepthFormat();
+    if (hasStencilComponent(target.depthFormat)) {
+      target.stencilFormat = target.depthFormat;
     }
+  } else {
+    target.renderPass = lveSwapChain->getRenderPass();
   }
+  return target;
 }
 
 void LveRenderer::createCommandBuffers() {
-  commandBuffers.resize(LveSwapChain::MAX_FRAMES_IN_FLIGHT);
+  commandBuffers.resize(framesInFlight);
 
   VkCommandBufferAllocateInfo allocInfo{};
   allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
@@ -63,13 +177,52 @@ void LveRenderer::freeCommandBuffers() {
   commandBuffers.clear();
 }
 
+void LveRenderer::createRecordingContexts() {
+  uint32_t slotCount = threadPool.threadCount() + 1;
+  recordingContexts.resize(framesInFlight);
+  for (auto &frameContexts : recordingContexts) {
+    frameContexts.resize(slotCount);
+    for (auto &context : frameContexts) {
+      VkCommandPoolCreateInfo poolInfo{};
+      poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+      poolInfo.queueFamilyIndex =
+          lveDevice.findPhysicalQueueFamilies().graphicsFamily;
+      poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+      if (vkCreateCommandPool(lveDevice.device(), &poolInfo,
+                              lveDevice.allocator(),
+                              &context.commandPool) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create recording command pool!");
+      }
+    }
+  }
+}
+
+void LveRenderer::destroyRecordingContexts() {
+  VkDevice device = lveDevice.device();
+  const VkAllocationCallbacks *allocator = lveDevice.allocator();
+  for (auto &frameContexts : recordingContexts) {
+    for (auto &context : frameContexts) {
+      VkCommandPool commandPool = context.commandPool;
+      lveDevice.deferDestruction([device, commandPool, allocator]() {
+        vkDestroyCommandPool(device, commandPool, allocator);
+      });
+    }
+  }
+  recordingContexts.clear();
+}
+
 VkCommandBuffer LveRenderer::beginFrame() {
   assert(!isFrameStarted && "cannot call beginFrame while already in progress");
 
+  lveDevice.retireTransfers();
+
   auto result = lveSwapChain->acquireNextImage(&currentImageIndex);
 
   if (result == VK_ERROR_OUT_OF_DATE_KHR) {
     recreateSwapChain();
+    // the input is sampled again for the next attempt
+    inputSampled = false;
     return nullptr;
   }
   if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
@@ -78,6 +231,20 @@ VkCommandBuffer LveRenderer::beginFrame() {
 
   isFrameStarted = true;
 
+  // the wait in acquireNextImage may have finished earlier captures
+  if (frameCapture != nullptr) {
+    frameCapture->collect();
+  }
+
+  // the fence wait in acquireNextImage means this frame's secondary buffers
+  // are no longer in use
+  for (auto &context : recordingContexts[currentFrameIndex]) {
+    if (context.usedCount > 0) {
+      vkResetCommandPool(lveDevice.device(), context.commandPool, 0);
+      context.usedCount = 0;
+    }
+  }
+
   auto commandBuffer = getCurentCommandBuffer();
 
   VkCommandBufferBeginInfo beginInfo{};
@@ -86,7 +253,25 @@ VkCommandBuffer LveRenderer::beginFrame() {
   if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
     throw std::runtime_error("failed to begin recording command buffer!");
   }
+  gpuProfiler.beginFrame(commandBuffer, currentFrameIndex);
+  frameScope = gpuProfiler.beginScope(commandBuffer, "frame");
+
+  // The profiler just read back the frame that last used this slot, unless
+  // its results were not ready or the slot is new. The controller only sees
+  // each GPU time once.
+  renderExtent = lveSwapChain->getSwapChainExtent();
+  if (dynamicResolutionEnabled) {
+    const auto &scopeStats = gpuProfiler.getScopeStats();
+    auto frameStats = scopeStats.find("frame");
+    if (frameStats != scopeStats.end() &&
+        frameStats->second.addedCount() != frameSamplesConsumed) {
+      frameSamplesConsumed = frameStats->second.addedCount();
+      dynamicResolution.update(frameStats->second.latest());
+    }
+    renderExtent = dynamicResolution.scaleExtent(renderExtent);
+  }
 
+  recordStart = std::chrono::steady_clock::now();
   return commandBuffer;
 }
 void LveRenderer::endFrame() {
@@ -94,47 +279,87 @@ void LveRenderer::endFrame() {
          "cannot call end frame while frame is not in progress");
 
   auto commandBuffer = getCurentCommandBuffer();
+  if (frameCapture != nullptr) {
+    frameCapture->record(commandBuffer,
+                         lveSwapChain->getImage(currentImageIndex),
+                         lveSwapChain->getSwapChainExtent(),
+                         lveSwapChain->getSwapChainImageFormat(),
+                         lveDevice.currentFrameSerial());
+  }
+  gpuProfiler.endScope(commandBuffer, frameScope);
   if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
     throw std::runtime_error("failed to record command buffer!");
   }
 
+  double recordMs = std::chrono::duration<double, std::milli>(
+                        std::chrono::steady_clock::now() - recordStart)
+                        .count();
+
   auto result =
       lveSwapChain->submitCommandBuffers(&commandBuffer, &currentImageIndex);
+  // taken before a recreation below replaces the swap chain
+  const auto &swapChainTimings = lveSwapChain->getFrameTimings();
+  lastFrameTimings = LveFrameStats::Frame{};
+  lastFrameTimings.fenceWaitMs = swapChainTimings.fenceWaitMs;
+  lastFrameTimings.acquireMs = swapChainTimings.acquireMs;
+  lastFrameTimings.recordMs = recordMs;
+  lastFrameTimings.presentMs = swapChainTimings.presentMs;
+  if (inputSampled) {
+    inputLatencyStats.add(std::chrono::duration<double, std::milli>(
+                              lveSwapChain->getLastPresentTime() -
+                              inputSampleTime)
+                              .count());
+    inputSampled = false;
+  }
   if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR ||
-      lveWindow.wasWindowResized()) {
+      lveWindow.wasWindowResized() || presentModeChanged) {
     lveWindow.resetWindowResizedFlag();
+    presentModeChanged = false;
     recreateSwapChain();
-  }
-  if (result != VK_SUCCESS) {
+  } else if (result != VK_SUCCESS) {
     throw std::runtime_error("failed to submit command buffers!");
   }
 
   isFrameStarted = false;
-  currentFrameIndex =
-      (currentFrameIndex + 1) % LveSwapChain::MAX_FRAMES_IN_FLIGHT;
+  currentFrameIndex = (currentFrameIndex + 1) % framesInFlight;
 }
-void LveRenderer::beginSwapChainRenderPass(VkCommandBuffer commandBuffer) {
+void LveRenderer::beginSwapChainRenderPass(VkCommandBuffer commandBuffer,
+                                           VkSubpassContents contents) {
   assert(isFrameStarted &&
          "cannot call beginSwapChainRenderPass if frame is not in progress");
   assert(commandBuffer == getCurentCommandBuffer() &&
          "cant begin render pass on command buffer froma different frame");
 
-  VkRenderPassBeginInfo renderPassInfo{};
-  renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-  renderPassInfo.renderPass = lveSwapChain->getRenderPass();
-  renderPassInfo.framebuffer = lveSwapChain->getFrameBuffer(currentImageIndex);
+  passScope = gpuProfiler.beginScope(commandBuffer, "main pass");
+  if (lveSwapChain->usesDynamicRendering()) {
+    setRenderTarget(getPipelineTarget(), VK_NULL_HANDLE,
+                    lveSwapChain->getSwapChainExtent());
+    beginDynamicRendering(commandBuffer, contents);
+  } else {
+    VkRenderPassBeginInfo renderPassInfo{};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    renderPassInfo.renderPass = lveSwapChain->getRenderPass();
+    renderPassInfo.framebuffer =
+        lveSwapChain->getFrameBuffer(currentImageIndex, currentFrameIndex);
+    setRenderTarget(getPipelineTarget(), renderPassInfo.framebuffer,
+                    lveSwapChain->getSwapChainExtent());
 
-  renderPassInfo.renderArea.offset = {0, 0};
-  renderPassInfo.renderArea.extent = lveSwapChain->getSwapChainExtent();
+    renderPassInfo.renderArea.offset = {0, 0};
+    renderPassInfo.renderArea.extent = lveSwapChain->getSwapChainExtent();
 
-  std::array<VkClearValue, 2> clearValues{};
-  clearValues[0].color = {0.01f, 0.01f, 0.01f, 1.0f};
-  clearValues[1].depthStencil = {1.0f, 0};
-  renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
-  renderPassInfo.pClearValues = clearValues.data();
+    std::array<VkClearValue, 2> clearValues{};
+    clearValues[0].color = {0.01f, 0.01f, 0.01f, 1.0f};
+    clearValues[1].depthStencil = {1.0f, 0};
+    renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+    renderPassInfo.pClearValues = clearValues.data();
 
-  vkCmdBeginRenderPass(commandBuffer, &renderPassInfo,
-                       VK_SUBPASS_CONTENTS_INLINE);
+    vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, contents);
+  }
+
+  // secondary buffers set their own dynamic state
+  if (contents == VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS) {
+    return;
+  }
 
   VkViewport viewport{};
   viewport.x = 0.0f;
@@ -153,7 +378,263 @@ void LveRenderer::endSwapChainRenderPass(VkCommandBuffer commandBuffer) {
          "cannot call endSwapChainRenderPass if frame is not in progress");
   assert(commandBuffer == getCurentCommandBuffer() &&
          "cant end render pass on command buffer froma different frame");
-  vkCmdEndRenderPass(commandBuffer);
+  if (!lveSwapChain->usesDynamicRendering()) {
+    vkCmdEndRenderPass(commandBuffer);
+    gpuProfiler.endScope(commandBuffer, passScope);
+    return;
+  }
+  lveDevice.cmdEndRendering(commandBuffer);
+
+  // the render pass' finalLayout, done by hand
+  VkImageMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+  barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+  barrier.oldLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.image = lveSwapChain->getImage(currentImageIndex);
+  barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+
+  VkPipelineStageFlags dstStage;
+  if (lveSwapChain->isHeadless()) {
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    dstStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+  } else {
+    barrier.dstAccessMask = 0;
+    barrier.newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    dstStage = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+  }
+  vkCmdPipelineBarrier(commandBuffer,
+                       VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, dstStage,
+                       0, 0, nullptr, 0, nullptr, 1, &barrier);
+  gpuProfiler.endScope(commandBuffer, passScope);
+}
+
+void LveRenderer::setRenderTarget(const PipelineTargetInfo &target,
+                                  VkFramebuffer framebuffer,
+                                  VkExtent2D extent) {
+  renderTarget = target;
+  renderTargetFramebuffer = framebuffer;
+  renderTargetExtent = extent;
+}
+
+void LveRenderer::beginDynamicRendering(VkCommandBuffer commandBuffer,
+                                        VkSubpassContents contents) {
+  VkFormat depthFormat = lveSwapChain->getSwapChainDepthFormat();
+  bool hasStencil = hasStencilComponent(depthFormat);
+
+  // what the render pass did through initialLayout and its external
+  // dependency, previous contents of both attachments are discarded
+  std::array<VkImageMemoryBarrier, 2> barriers{};
+  barriers[0].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+  barriers[0].srcAccessMask = 0;
+  barriers[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+  barriers[0].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  barriers[0].newLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+  barriers[0].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barriers[0].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barriers[0].image = lveSwapChain->getImage(currentImageIndex);
+  barriers[0].subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+
+  barriers[1].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+  barriers[1].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+  barriers[1].dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT |
+                              VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+  barriers[1].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  barriers[1].newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+  barriers[1].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barriers[1].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barriers[1].image = lveSwapChain->getDepthImage(currentFrameIndex);
+  barriers[1].subresourceRange = {
+      static_cast<VkImageAspectFlags>(
+          VK_IMAGE_ASPECT_DEPTH_BIT |
+          (hasStencil ? VK_IMAGE_ASPECT_STENCIL_BIT : 0)),
+      0, 1, 0, 1};
+
+  VkPipelineStageFlags stages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT |
+                                VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT |
+                                VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+  vkCmdPipelineBarrier(commandBuffer, stages, stages, 0, 0, nullptr, 0,
+                       nullptr, static_cast<uint32_t>(barriers.size()),
+                       barriers.data());
+
+  VkRenderingAttachmentInfo colorAttachment{};
+  colorAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+  colorAttachment.imageView = lveSwapChain->getImageView(currentImageIndex);
+  colorAttachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+  colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+  colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+  colorAttachment.clearValue.color = {0.01f, 0.01f, 0.01f, 1.0f};
+
+  VkRenderingAttachmentInfo depthAttachment{};
+  depthAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+  depthAttachment.imageView =
+      lveSwapChain->getDepthImageView(currentFrameIndex);
+  depthAttachment.imageLayout =
+      VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+  depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+  depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+  depthAttachment.clearValue.depthStencil = {1.0f, 0};
+
+  VkRenderingInfo renderingInfo{};
+  renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+  if (contents == VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS) {
+    renderingInfo.flags = VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT;
+  }
+  renderingInfo.renderArea.offset = {0, 0};
+  renderingInfo.renderArea.extent = lveSwapChain->getSwapChainExtent();
+  renderingInfo.layerCount = 1;
+  renderingInfo.colorAttachmentCount = 1;
+  renderingInfo.pColorAttachments = &colorAttachment;
+  renderingInfo.pDepthAttachment = &depthAttachment;
+  renderingInfo.pStencilAttachment = hasStencil ? &depthAttachment : nullptr;
+
+  lveDevice.cmdBeginRendering(commandBuffer, &renderingInfo);
+}
+
+VkCommandBuffer
+LveRenderer::beginSecondaryCommandBuffer(RecordingContext &context) {
+  if (context.usedCount == context.commandBuffers.size()) {
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+    allocInfo.commandPool = context.commandPool;
+    allocInfo.commandBufferCount = 1;
+
+    VkCommandBuffer commandBuffer;
+    if (vkAllocateCommandBuffers(lveDevice.device(), &allocInfo,
+                                 &commandBuffer) != VK_SUCCESS) {
+      throw std::runtime_error("failed to allocate secondary command buffer!");
+    }
+    context.commandBuffers.push_back(commandBuffer);
+  }
+  VkCommandBuffer commandBuffer = context.commandBuffers[context.usedCount++];
+
+  const PipelineTargetInfo &target = renderTarget;
+  VkCommandBufferInheritanceRenderingInfo renderingInheritance{};
+  renderingInheritance.sType =
+      VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO;
+  renderingInheritance.colorAttachmentCount =
+      target.colorFormat != VK_FORMAT_UNDEFINED ? 1 : 0;
+  renderingInheritance.pColorAttachmentFormats = &target.colorFormat;
+  renderingInheritance.depthAttachmentFormat = target.depthFormat;
+  renderingInheritance.stencilAttachmentFormat = target.stencilFormat;
+  renderingInheritance.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+  VkCommandBufferInheritanceInfo inheritanceInfo{};
+  inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+  if (target.renderPass == VK_NULL_HANDLE) {
+    inheritanceInfo.pNext = &renderingInheritance;
+  } else {
+    inheritanceInfo.renderPass = target.renderPass;
+    inheritanceInfo.subpass = target.subpass;
+    inheritanceInfo.framebuffer = renderTargetFramebuffer;
+  }
+
+  VkCommandBufferBeginInfo beginInfo{};
+  beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT |
+                    VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+  beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+  if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+    throw std::runtime_error(
+        "failed to begin recording secondary command buffer!");
+  }
+
+  VkExtent2D extent = renderTargetExtent;
+  VkViewport viewport{};
+  viewport.x = 0.0f;
+  viewport.y = 0.0f;
+  viewport.width = static_cast<float>(extent.width);
+  viewport.height = static_cast<float>(extent.height);
+  viewport.minDepth = 0.0f;
+  viewport.maxDepth = 1.0f;
+  VkRect2D scissor{{0, 0}, extent};
+  vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+  vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+  return commandBuffer;
+}
+
+void LveRenderer::recordParallel(
+    VkCommandBuffer commandBuffer, size_t itemCount,
+    const std::function<void(VkCommandBuffer, size_t, size_t)> &recordRange,
+    const char *profileScope) {
+  assert(isFrameStarted &&
+         "cannot call recordParallel if frame is not in progress");
+  if (itemCount == 0) {
+    return;
+  }
+  // timestamps can't go into the primary inside this render pass, the first
+  // and last chunk write them instead
+  uint32_t scope = profileScope != nullptr
+                       ? gpuProfiler.reserveScope(profileScope)
+                       : LveGpuProfiler::NO_SCOPE;
+
+  auto &frameContexts = recordingContexts[currentFrameIndex];
+  size_t chunkCount = std::min<size_t>(
+      frameContexts.size(),
+      (itemCount + MIN_ITEMS_PER_RECORDING_CHUNK - 1) /
+          MIN_ITEMS_PER_RECORDING_CHUNK);
+  size_t chunkSize = (itemCount + chunkCount - 1) / chunkCount;
+
+  // statistics queries can't span secondary buffers, each chunk counts its
+  // own and the profiler sums them by name
+  std::vector<uint32_t> statisticsQueries(chunkCount,
+                                          LveGpuProfiler::NO_SCOPE);
+  if (profileScope != nullptr) {
+    for (auto &query : statisticsQueries) {
+      query = gpuProfiler.reserveStatistics(profileScope);
+    }
+  }
+
+  std::vector<VkCommandBuffer> secondaryBuffers(chunkCount);
+  auto recordChunk = [&](size_t chunk) {
+    VkCommandBuffer secondary =
+        beginSecondaryCommandBuffer(frameContexts[chunk]);
+    if (chunk == 0) {
+      gpuProfiler.writeBegin(secondary, scope);
+    }
+    gpuProfiler.beginStatistics(secondary, statisticsQueries[chunk]);
+    size_t begin = chunk * chunkSize;
+    size_t end = std::min(itemCount, begin + chunkSize);
+    recordRange(secondary, begin, end);
+    gpuProfiler.endStatistics(secondary, statisticsQueries[chunk]);
+    if (chunk == chunkCount - 1) {
+      gpuProfiler.writeEnd(secondary, scope);
+    }
+    if (vkEndCommandBuffer(secondary) != VK_SUCCESS) {
+      throw std::runtime_error("failed to record secondary command buffer!");
+    }
+    secondaryBuffers[chunk] = secondary;
+  };
+
+  // the last chunk is recorded on this thread while the workers run, ahead
+  // of any queued background work
+  std::vector<std::future<void>> chunks;
+  for (size_t chunk = 0; chunk + 1 < chunkCount; chunk++) {
+    chunks.push_back(
+        threadPool.submit([&recordChunk, chunk]() { recordChunk(chunk); },
+                          LveThreadPool::Priority::High));
+  }
+  try {
+    recordChunk(chunkCount - 1);
+  } catch (...) {
+    // the workers still reference this frame's locals
+    for (auto &chunk : chunks) {
+      chunk.wait();
+    }
+    throw;
+  }
+  for (auto &chunk : chunks) {
+    chunk.get();
+  }
+
+  vkCmdExecuteCommands(commandBuffer,
+                       static_cast<uint32_t>(secondaryBuffers.size()),
+                       secondaryBuffers.data());
 }
 
 } // namespace lve
@@ -1,11 +1,20 @@
 #pragma once
 
 #include "lve_device.hpp"
+#include "lve_dynamic_resolution.hpp"
+#include "lve_frame_capture.hpp"
+#include "lve_frame_stats.hpp"
+#include "lve_gpu_profiler.hpp"
+#include "lve_pipeline.hpp"
+#include "lve_stats.hpp"
 #include "lve_swap_chain.hpp"
+#include "lve_thread_pool.hpp"
 #include "lve_window.hpp"
 
 #include <algorithm>
 #include <cassert>
+#include <chrono>
+#include <functional>
 #include <memory>
 #include <vector>
 #include <vulkan/vulkan_core.h>
@@ -13,7 +22,15 @@
 namespace lve {
 class LveRenderer {
 public:
-  LveRenderer(LveWindow &window, LveDevice &device);
+  // below this many items per chunk recordParallel uses fewer threads
+  static constexpr size_t MIN_ITEMS_PER_RECORDING_CHUNK = 256;
+
+  // recordParallel's chunks run on threadPool at high priority, a pool of
+  // its own keeps them from waiting for background jobs already running
+  LveRenderer(
+      LveWindow &window, LveDevice &device, LveThreadPool &threadPool,
+      VkPresentModeKHR presentMode = VK_PRESENT_MODE_MAILBOX_KHR,
+      uint32_t framesInFlight = LveSwapChain::DEFAULT_FRAMES_IN_FLIGHT);
   ~LveRenderer();
 
   LveRenderer(const LveRenderer &) = delete;
@@ -22,11 +39,108 @@ public:
   VkRenderPass getSwapChainRenderPass() const {
     return lveSwapChain->getRenderPass();
   }
+  // stays valid across swap chain recreation as long as the formats match,
+  // the version changes when they did not and pipelines need rebuilding
+  PipelineTargetInfo getPipelineTarget() const;
+  uint32_t getPipelineTargetVersion() const { return pipelineTargetVersion; }
 
   float getAspectRatio() const { return lveSwapChain->extentAspectRatio(); }
+  const LveSwapChain::FrameSyncStats &getFrameSyncStats() const {
+    return lveSwapChain->getFrameSyncStats();
+  }
+  bool usesTimelineSync() const { return lveSwapChain->usesTimelineSync(); }
+  bool usesDynamicRendering() const {
+    return lveSwapChain->usesDynamicRendering();
+  }
+  bool isHeadless() const { return lveSwapChain->isHeadless(); }
+
+  // bumped whenever the swap chain is recreated, image views from an older
+  // generation may already have been destroyed
+  uint32_t getSwapChainGeneration() const { return swapChainGeneration; }
+  VkExtent2D getSwapChainExtent() const {
+    return lveSwapChain->getSwapChainExtent();
+  }
+  VkFormat getSwapChainImageFormat() const {
+    return lveSwapChain->getSwapChainImageFormat();
+  }
+  VkFormat getSwapChainDepthFormat() const {
+    return lveSwapChain->getSwapChainDepthFormat();
+  }
+  // the image acquired by beginFrame and the frame's depth attachment
+  VkImage getSwapChainImage() const {
+    return lveSwapChain->getImage(currentImageIndex);
+  }
+  VkImageView getSwapChainImageView() const {
+    return lveSwapChain->getImageView(currentImageIndex);
+  }
+  VkImage getDepthImage() const {
+    return lveSwapChain->getDepthImage(currentFrameIndex);
+  }
+  VkImageView getDepthImageView() const {
+    return lveSwapChain->getDepthImageView(currentFrameIndex);
+  }
+
+  // the swap chain is recreated with the new mode at the end of the current
+  // or next frame
+  void setPresentMode(VkPresentModeKHR presentMode);
+  // the mode actually in use, FIFO when the requested one is unsupported
+  VkPresentModeKHR getPresentMode() const {
+    return lveSwapChain->getPresentMode();
+  }
+  // the mode last passed to setPresentMode or the constructor
+  VkPresentModeKHR getRequestedPresentMode() const { return presentMode; }
+
+  // Waits for the device to go idle and rebuilds every per frame resource
+  // the renderer owns. Callers have to rebuild their own per frame resources
+  // afterwards, sized from getFramesInFlight().
+  void setFramesInFlight(uint32_t framesInFlight);
+  uint32_t getFramesInFlight() const { return framesInFlight; }
 
   bool isFrameInProgress() const { return isFrameStarted; }
 
+  // The input the next submitted frame is built from was sampled now. The
+  // next endFrame records the time from here until the frame was handed to
+  // vkQueuePresentKHR, a beginFrame that returns null drops the sample.
+  void markInputSampled() {
+    inputSampleTime = std::chrono::steady_clock::now();
+    inputSampled = true;
+  }
+  // where the CPU time of the last submitted frame went, apart from its
+  // total which only the caller's loop knows
+  const LveFrameStats::Frame &getLastFrameTimings() const {
+    return lastFrameTimings;
+  }
+  // input to present latency in milliseconds
+  const LveRollingStats &getInputLatencyStats() const {
+    return inputLatencyStats;
+  }
+
+  // Copies every rendered frame into a ring of slotCount readback buffers
+  // and passes it to callback from a later beginFrame. Headless only.
+  void enableFrameCapture(uint32_t slotCount,
+                          LveFrameCapture::Callback callback);
+  LveFrameCapture *getFrameCapture() { return frameCapture.get(); }
+
+  // Scene passes render into the top left getRenderExtent() of an offscreen
+  // target of the full size and recordUpscale blits that into the swap chain
+  // image. Each beginFrame feeds the GPU frame time it read back to the
+  // controller, which picks the scale of that frame.
+  // the swap chain images can be blitted to, and the scene color format
+  // blitted from
+  bool supportsDynamicResolution() const;
+  void setDynamicResolution(bool enabled);
+  bool usesDynamicResolution() const { return dynamicResolutionEnabled; }
+  LveDynamicResolution &getDynamicResolution() { return dynamicResolution; }
+  // the extent scene passes render at, fixed between beginFrame and endFrame
+  VkExtent2D getRenderExtent() const { return renderExtent; }
+  // source in TRANSFER_SRC_OPTIMAL, the acquired image in
+  // TRANSFER_DST_OPTIMAL, filtered linearly where the format allows it
+  void recordUpscale(VkCommandBuffer commandBuffer, VkImage source);
+
+  // frame and main pass scopes are recorded by the renderer, render systems
+  // add their own
+  LveGpuProfiler &getGpuProfiler() { return gpuProfiler; }
+
   VkCommandBuffer getCurentCommandBuffer() const {
     assert(isFrameStarted &&
            "cannot get command buffer when frame not in progress");
@@ -41,21 +155,86 @@ public:
 
   VkCommandBuffer beginFrame();
   void endFrame();
-  void beginSwapChainRenderPass(VkCommandBuffer commandBuffer);
+  void beginSwapChainRenderPass(
+      VkCommandBuffer commandBuffer,
+      VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE);
   void endSwapChainRenderPass(VkCommandBuffer commandBuffer);
+  // Rendering begun anywhere but beginSwapChainRenderPass, like a render
+  // graph pass, is reported here so recordParallel's secondary buffers
+  // inherit its attachments. framebuffer is ignored with dynamic rendering.
+  void setRenderTarget(const PipelineTargetInfo &target,
+                       VkFramebuffer framebuffer, VkExtent2D extent);
+
+  // Splits itemCount items into chunks that are recorded concurrently into
+  // secondary command buffers and executed in the swap chain render pass,
+  // which has to have been begun with
+  // VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS. recordRange is called with
+  // a secondary buffer that already has the viewport and scissor set, and
+  // the [begin, end) range it should record. With a profileScope the GPU
+  // time of all chunks is reported under that name.
+  void recordParallel(
+      VkCommandBuffer commandBuffer, size_t itemCount,
+      const std::function<void(VkCommandBuffer, size_t, size_t)> &recordRange,
+      const char *profileScope = nullptr);
+
+  // one slot per worker plus the main thread
+  uint32_t getRecordingSlotCount() const {
+    return static_cast<uint32_t>(recordingContexts[0].size());
+  }
 
 private:
+  // A command pool is only used by one thread at a time, each slot of a
+  // frame has its own, reset as a whole once the frame's fence has passed.
+  struct RecordingContext {
+    VkCommandPool commandPool;
+    std::vector<VkCommandBuffer> commandBuffers;
+    size_t usedCount = 0;
+  };
+
   void createCommandBuffers();
   void freeCommandBuffers();
+  void createRecordingContexts();
+  void destroyRecordingContexts();
   void recreateSwapChain();
+  void beginDynamicRendering(VkCommandBuffer commandBuffer,
+                             VkSubpassContents contents);
+  VkCommandBuffer beginSecondaryCommandBuffer(RecordingContext &context);
 
   LveWindow &lveWindow;
   LveDevice &lveDevice;
+  LveThreadPool &threadPool;
+  LveGpuProfiler gpuProfiler;
   std::unique_ptr<LveSwapChain> lveSwapChain;
+  std::unique_ptr<LveFrameCapture> frameCapture;
   std::vector<VkCommandBuffer> commandBuffers;
+  std::vector<std::vector<RecordingContext>> recordingContexts;
+
+  VkPresentModeKHR presentMode;
+  bool presentModeChanged = false;
+  LveDynamicResolution dynamicResolution{};
+  bool dynamicResolutionEnabled = false;
+  VkFilter upscaleFilter = VK_FILTER_NEAREST;
+  // addedCount() of the profiler's frame scope when it last fed the controller
+  uint64_t frameSamplesConsumed = 0;
+  VkExtent2D renderExtent{};
+  std::chrono::steady_clock::time_point inputSampleTime{};
+  bool inputSampled = false;
+  LveRollingStats inputLatencyStats{};
+  std::chrono::steady_clock::time_point recordStart{};
+  LveFrameStats::Frame lastFrameTimings{};
+  uint32_t framesInFlight;
+  uint32_t pipelineTargetVersion = 0;
+  uint32_t swapChainGeneration = 0;
+
+  // what recordParallel's secondary buffers render into
+  PipelineTargetInfo renderTarget{};
+  VkFramebuffer renderTargetFramebuffer = VK_NULL_HANDLE;
+  VkExtent2D renderTargetExtent{};
 
   uint32_t currentImageIndex;
-  int currentFrameIndex;
+  int currentFrameIndex = 0;
   bool isFrameStarted = false;
+  uint32_t frameScope = LveGpuProfiler::NO_SCOPE;
+  uint32_t passScope = LveGpuProfiler::NO_SCOPE;
 };
 } // namespace lve
@@ -0,0 +1,109 @@
+#include "lve_shm_frame_sink.hpp"
+
+// posix
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// std
+#include <chrono>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+
+namespace lve {
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free &&
+                  std::atomic<uint32_t>::is_always_lock_free,
+              "shared memory counters have to be lock free");
+
+static constexpr uint64_t SLOT_ALIGNMENT = 4096;
+
+static uint64_t alignUp(uint64_t value, uint64_t alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+LveShmFrameSink::LveShmFrameSink(const std::string &name, uint32_t slotCount,
+                                 uint64_t maxFrameBytes)
+    : name{name} {
+  uint64_t headerSize = alignUp(sizeof(ShmHeader), SLOT_ALIGNMENT);
+  uint64_t slotStride =
+      alignUp(sizeof(ShmSlot) + maxFrameBytes, SLOT_ALIGNMENT);
+  mappingSize = static_cast<size_t>(headerSize + slotStride * slotCount);
+
+  // a segment left by an earlier run may still be mapped by a reader, which
+  // must not see its valid header over slots being rebuilt, so the name
+  // always gets a fresh zero filled segment
+  shm_unlink(name.c_str());
+  fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+  if (fd < 0) {
+    throw std::runtime_error("failed to open shared memory " + name + "!");
+  }
+  if (ftruncate(fd, static_cast<off_t>(mappingSize)) != 0) {
+    close(fd);
+    shm_unlink(name.c_str());
+    throw std::runtime_error("failed to size shared memory " + name + "!");
+  }
+  mapping =
+      mmap(nullptr, mappingSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (mapping == MAP_FAILED) {
+    close(fd);
+    shm_unlink(name.c_str());
+    throw std::runtime_error("failed to map shared memory " + name + "!");
+  }
+
+  auto *base = static_cast<unsigned char *>(mapping);
+  for (uint32_t i = 0; i < slotCount; i++) {
+    auto *slot = new (base + headerSize + slotStride * i) ShmSlot{};
+    slot->sequence.store(0, std::memory_order_relaxed);
+  }
+  header = new (base) ShmHeader{};
+  header->slotCount = slotCount;
+  header->slotStride = slotStride;
+  header->maxFrameBytes = maxFrameBytes;
+  header->version = VERSION;
+  header->publishedCount.store(0, std::memory_order_relaxed);
+  // written last so consumers only see a complete header
+  header->magic.store(MAGIC, std::memory_order_release);
+}
+
+LveShmFrameSink::~LveShmFrameSink() {
+  munmap(mapping, mappingSize);
+  close(fd);
+  shm_unlink(name.c_str());
+}
+
+void LveShmFrameSink::publish(const LveCapturedFrame &frame) {
+  uint64_t frameBytes = static_cast<uint64_t>(frame.rowPitch) * frame.height;
+  if (frameBytes > header->maxFrameBytes) {
+    droppedCount++;
+    return;
+  }
+
+  uint64_t count = header->publishedCount.load(std::memory_order_relaxed);
+  auto *base = static_cast<unsigned char *>(mapping);
+  auto *slot = reinterpret_cast<ShmSlot *>(
+      base + alignUp(sizeof(ShmHeader), SLOT_ALIGNMENT) +
+      header->slotStride * (count % header->slotCount));
+
+  uint64_t sequence = slot->sequence.load(std::memory_order_relaxed);
+  slot->sequence.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  slot->frameNumber = frame.frameNumber;
+  slot->timestampNs = static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now().time_since_epoch())
+          .count());
+  slot->width = frame.width;
+  slot->height = frame.height;
+  slot->rowPitch = frame.rowPitch;
+  slot->format = static_cast<uint32_t>(frame.format);
+  std::memcpy(reinterpret_cast<unsigned char *>(slot) + sizeof(ShmSlot),
+              frame.pixels, frameBytes);
+
+  slot->sequence.store(sequence + 2, std::memory_order_release);
+  header->publishedCount.store(count + 1, std::memory_order_release);
+}
+
+} // namespace lve
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "lve_frame_capture.hpp"
+
+// std
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace lve {
+
+// Publishes captured frames into a POSIX shared memory ring for a consumer
+// in another process, e.g. a video encoder. The segment starts with a
+// ShmHeader followed by slotCount slots of slotStride bytes, each a ShmSlot
+// followed by the pixels. A slot's sequence is odd while it is being
+// written, consumers copy the pixels out and retry if the sequence changed
+// meanwhile. Frames larger than maxFrameBytes are dropped.
+class LveShmFrameSink {
+public:
+  static constexpr uint32_t MAGIC = 0x4645564c; // "LVEF"
+  static constexpr uint32_t VERSION = 1;
+
+  struct ShmHeader {
+    // stored last, a consumer that sees MAGIC sees the whole header
+    std::atomic<uint32_t> magic;
+    uint32_t version;
+    uint32_t slotCount;
+    uint32_t reserved;
+    uint64_t slotStride;
+    uint64_t maxFrameBytes;
+    // frames published so far, the newest is in slot (count - 1) % slotCount
+    std::atomic<uint64_t> publishedCount;
+  };
+
+  struct ShmSlot {
+    std::atomic<uint64_t> sequence;
+    uint64_t frameNumber;
+    uint64_t timestampNs;
+    uint32_t width;
+    uint32_t height;
+    uint32_t rowPitch;
+    uint32_t format;
+  };
+
+  LveShmFrameSink(const std::string &name, uint32_t slotCount,
+                  uint64_t maxFrameBytes);
+  ~LveShmFrameSink();
+
+  LveShmFrameSink(const LveShmFrameSink &) = delete;
+  LveShmFrameSink &operator=(const LveShmFrameSink &) = delete;
+
+  void publish(const LveCapturedFrame &frame);
+  uint64_t getDroppedCount() const { return droppedCount; }
+
+private:
+  std::string name;
+  int fd = -1;
+  void *mapping = nullptr;
+  size_t mappingSize = 0;
+  ShmHeader *header = nullptr;
+  uint64_t droppedCount = 0;
+};
+
+} // namespace lve
@@ -0,0 +1,120 @@
+#include "lve_startup_profiler.hpp"
+
+// std
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <thread>
+
+namespace lve {
+
+static thread_local int scopeDepth = 0;
+static const std::thread::id mainThreadId = std::this_thread::get_id();
+
+LveStartupProfiler::Scope::Scope(std::string name)
+    : name{std::move(name)}, start{Clock::now()}, depth{scopeDepth++} {}
+
+LveStartupProfiler::Scope::~Scope() {
+  scopeDepth--;
+  LveStartupProfiler::instance().record(name, start, Clock::now(), depth);
+}
+
+LveStartupProfiler::LveStartupProfiler() : origin{Clock::now()} {}
+
+LveStartupProfiler &LveStartupProfiler::instance() {
+  static LveStartupProfiler profiler;
+  return profiler;
+}
+
+void LveStartupProfiler::start() {
+  std::lock_guard<std::mutex> lock{mutex};
+  origin = Clock::now();
+  phases.clear();
+  finished = false;
+}
+
+double
+LveStartupProfiler::millisecondsSinceStart(Clock::time_point time) const {
+  return std::chrono::duration<double, std::milli>(time - origin).count();
+}
+
+void LveStartupProfiler::record(const std::string &name,
+                                Clock::time_point begin, Clock::time_point end,
+                                int depth) {
+  std::lock_guard<std::mutex> lock{mutex};
+  if (finished) {
+    return;
+  }
+  phases.push_back({name, millisecondsSinceStart(begin),
+                    std::chrono::duration<double, std::milli>(end - begin)
+                        .count(),
+                    depth, std::this_thread::get_id() == mainThreadId});
+}
+
+void LveStartupProfiler::markFirstPresent() {
+  std::lock_guard<std::mutex> lock{mutex};
+  if (finished) {
+    return;
+  }
+  finished = true;
+
+  double timeToFirstPresentMs = millisecondsSinceStart(Clock::now());
+  phases.push_back({"first vkQueuePresentKHR", timeToFirstPresentMs, 0.0, 0,
+                    std::this_thread::get_id() == mainThreadId});
+
+  // scopes are recorded when they end, order by start for the breakdown
+  std::stable_sort(phases.begin(), phases.end(),
+                   [](const Phase &a, const Phase &b) {
+                     return a.startMs < b.startMs;
+                   });
+
+  printBreakdown(timeToFirstPresentMs);
+  writeJson(timeToFirstPresentMs);
+}
+
+void LveStartupProfiler::printBreakdown(double timeToFirstPresentMs) const {
+  std::cout << "startup profile, first frame presented after "
+            << timeToFirstPresentMs << " ms" << std::endl;
+  std::cout << "     start(ms)  duration(ms)  phase" << std::endl;
+  for (auto &phase : phases) {
+    char line[64];
+    std::snprintf(line, sizeof(line), "  %12.2f  %12.2f  ", phase.startMs,
+                  phase.durationMs);
+    std::cout << line << std::string(phase.depth * 2, ' ') << phase.name
+              << (phase.mainThread ? "" : " [worker]") << std::endl;
+  }
+}
+
+static std::string escapeJson(const std::string &value) {
+  std::string escaped;
+  for (char c : value) {
+    if (c == '"' || c == '\\') {
+      escaped += '\\';
+    }
+    escaped += c;
+  }
+  return escaped;
+}
+
+void LveStartupProfiler::writeJson(double timeToFirstPresentMs) const {
+  std::ofstream file{jsonPath, std::ios::trunc};
+  if (!file.is_open()) {
+    std::cerr << "startup profile: failed to write " << jsonPath << std::endl;
+    return;
+  }
+
+  file << "{\n  \"timeToFirstPresentMs\": " << timeToFirstPresentMs
+       << ",\n  \"phases\": [";
+  for (size_t i = 0; i < phases.size(); i++) {
+    auto &phase = phases[i];
+    file << (i == 0 ? "\n" : ",\n") << "    {\"name\": \""
+         << escapeJson(phase.name) << "\", \"startMs\": " << phase.startMs
+         << ", \"durationMs\": " << phase.durationMs
+         << ", \"depth\": " << phase.depth << ", \"mainThread\": "
+         << (phase.mainThread ? "true" : "false") << "}";
+  }
+  file << "\n  ]\n}\n";
+}
+
+} // namespace lve
@@ -0,0 +1,66 @@
+#pragma once
+
+// std
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace lve {
+
+// Records how long each startup phase takes, from main() up to the first
+// presented frame. The breakdown is printed and written as JSON once the
+// first frame is presented, phases after that are ignored.
+class LveStartupProfiler {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  struct Phase {
+    std::string name;
+    double startMs;
+    double durationMs;
+    int depth;
+    bool mainThread;
+  };
+
+  // Times the enclosing block as a phase. Nested scopes on the same thread
+  // are indented in the breakdown.
+  class Scope {
+  public:
+    explicit Scope(std::string name);
+    ~Scope();
+
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+
+  private:
+    std::string name;
+    Clock::time_point start;
+    int depth;
+  };
+
+  static LveStartupProfiler &instance();
+
+  // resets the origin, call first thing in main
+  void start();
+  void markFirstPresent();
+  bool isFinished() const { return finished; }
+
+private:
+  LveStartupProfiler();
+
+  void record(const std::string &name, Clock::time_point begin,
+              Clock::time_point end, int depth);
+  void printBreakdown(double timeToFirstPresentMs) const;
+  void writeJson(double timeToFirstPresentMs) const;
+  double millisecondsSinceStart(Clock::time_point time) const;
+
+  const std::string jsonPath = "startup_profile.json";
+
+  mutable std::mutex mutex;
+  Clock::time_point origin;
+  std::vector<Phase> phases;
+  bool finished = false;
+};
+
+} // namespace lve
@@ -0,0 +1,73 @@
+#include "lve_stats.hpp"
+
+// std
+#include <algorithm>
+#include <cmath>
+
+namespace lve {
+
+LveRollingStats::LveRollingStats(size_t windowSize)
+    : windowSize{std::max<size_t>(windowSize, 1)} {
+  samples.reserve(this->windowSize);
+}
+
+void LveRollingStats::add(double value) {
+  if (samples.size() < windowSize) {
+    samples.push_back(value);
+  } else {
+    samples[next] = value;
+  }
+  next = (next + 1) % windowSize;
+  added++;
+}
+
+void LveRollingStats::clear() {
+  samples.clear();
+  next = 0;
+}
+
+double LveRollingStats::latest() const {
+  if (samples.empty()) {
+    return 0.0;
+  }
+  return samples[(next + windowSize - 1) % windowSize];
+}
+
+double LveRollingStats::average() const {
+  if (samples.empty()) {
+    return 0.0;
+  }
+  double sum = 0.0;
+  for (double sample : samples) {
+    sum += sample;
+  }
+  return sum / static_cast<double>(samples.size());
+}
+
+double LveRollingStats::min() const {
+  if (samples.empty()) {
+    return 0.0;
+  }
+  return *std::min_element(samples.begin(), samples.end());
+}
+
+double LveRollingStats::max() const {
+  if (samples.empty()) {
+    return 0.0;
+  }
+  return *std::max_element(samples.begin(), samples.end());
+}
+
+double LveRollingStats::percentile(double p) const {
+  if (samples.empty()) {
+    return 0.0;
+  }
+  std::vector<double> sorted = samples;
+  size_t rank = static_cast<size_t>(
+      std::ceil(std::clamp(p, 0.0, 100.0) / 100.0 * sorted.size()));
+  size_t index = rank == 0 ? 0 : rank - 1;
+  std::nth_element(sorted.begin(), sorted.begin() + index, sorted.end());
+  return sorted[index];
+}
+
+} // namespace lve
@@ -0,0 +1,37 @@
+#pragma once
+
+// std
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace lve {
+
+// Keeps the last windowSize samples of a per frame measurement and reports
+// their average and percentiles.
+class LveRollingStats {
+public:
+  explicit LveRollingStats(size_t windowSize = 240);
+
+  void add(double value);
+  void clear();
+
+  size_t count() const { return samples.size(); }
+  // every sample added so far, keeps counting once the window is full so a
+  // change tells a new sample from the same latest() read twice
+  uint64_t addedCount() const { return added; }
+  double latest() const;
+  double average() const;
+  double min() const;
+  double max() const;
+  // nearest rank percentile over the window, p in [0, 100]
+  double percentile(double p) const;
+
+private:
+  size_t windowSize;
+  std::vector<double> samples;
+  size_t next = 0;
+  uint64_t added = 0;
+};
+
+} // namespace lve
@@ -1,120 +1,249 @@
 
 #include "lve_swap_chain.hpp"
+#include "lve_startup_profiler.hpp"
 
 // std
 #include <array>
+#include <chrono>
 #include <cstdlib>
 #include <cstring>
 #include <iostream>
 #include <limits>
 #include <set>
 #include <stdexcept>
+#include <utility>
 
 namespace lve {
 
-LveSwapChain::LveSwapChain(LveDevice &deviceRef, VkExtent2D extent)
-    : device{deviceRef}, windowExtent{extent} {
+LveSwapChain::LveSwapChain(LveDevice &deviceRef, VkExtent2D extent,
+                           VkPresentModeKHR preferredPresentMode,
+                           uint32_t framesInFlight)
+    : device{deviceRef}, windowExtent{extent},
+      preferredPresentMode{preferredPresentMode},
+      framesInFlight{framesInFlight},
+      headless{deviceRef.isHeadless()},
+      dynamicRendering{deviceRef.useDynamicRendering()},
+      timelineSync{deviceRef.useTimelineSemaphore()} {
   init();
 }
 
 LveSwapChain::LveSwapChain(LveDevice &deviceRef, VkExtent2D extent,
+                           VkPresentModeKHR preferredPresentMode,
+                           uint32_t framesInFlight,
                            std::shared_ptr<LveSwapChain> previous)
-    : device{deviceRef}, windowExtent{extent}, oldSwapChain{previous} {
+    : device{deviceRef}, windowExtent{extent},
+      preferredPresentMode{preferredPresentMode},
+      framesInFlight{framesInFlight}, headless{deviceRef.isHeadless()},
+      dynamicRendering{deviceRef.useDynamicRendering()},
+      timelineSync{deviceRef.useTimelineSemaphore()}, oldSwapChain{previous} {
   init();
+  syncStats = previous->syncStats;
 
-  // clean up old swap chain
+  // the old chain defers its own destruction until its last frame retires
   oldSwapChain = nullptr;
 }
 
 void LveSwapChain::init() {
-  createSwapChain();
+  LveStartupProfiler::Scope profile{"LveSwapChain::init"};
+  if (headless) {
+    createOffscreenImages();
+  } else {
+    createSwapChain();
+  }
   createImageViews();
-  createRenderPass();
+  swapChainDepthFormat = findDepthFormat();
+  if (!dynamicRendering) {
+    createRenderPass();
+  }
   createDepthResources();
-  createFramebuffers();
   createSyncObjects();
 }
 
 LveSwapChain::~LveSwapChain() {
-  for (auto imageView : swapChainImageViews) {
-    vkDestroyImageView(device.device(), imageView, nullptr);
-  }
-  swapChainImageViews.clear();
-
-  if (swapChain != nullptr) {
-    vkDestroySwapchainKHR(device.device(), swapChain, nullptr);
-    swapChain = nullptr;
-  }
-
-  for (int i = 0; i < depthImages.size(); i++) {
-    vkDestroyImageView(device.device(), depthImageViews[i], nullptr);
-    vkDestroyImage(device.device(), depthImages[i], nullptr);
-    vkFreeMemory(device.device(), depthImageMemorys[i], nullptr);
+  // Frames recorded against this chain may still be executing or waiting to
+  // be presented, so everything is released once they have retired. Objects
+  // handed over to a newer chain have already been taken out.
+  if (headless) {
+    for (size_t i = 0; i < swapChainImages.size(); i++) {
+      device.destroyImageDeferred(swapChainImages[i], swapChainImageViews[i],
+                                  offscreenImageMemorys[i]);
+    }
+    swapChainImageViews.clear();
   }
 
-  for (auto framebuffer : swapChainFramebuffers) {
-    vkDestroyFramebuffer(device.device(), framebuffer, nullptr);
+  for (size_t i = 0; i < depthImages.size(); i++) {
+    device.destroyImageDeferred(depthImages[i], depthImageViews[i],
+                                depthImageMemorys[i]);
   }
 
-  vkDestroyRenderPass(device.device(), renderPass, nullptr);
-
-  // cleanup synchronization objects
-  for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-    vkDestroySemaphore(device.device(), renderFinishedSemaphores[i], nullptr);
-    vkDestroySemaphore(device.device(), imageAvailableSemaphores[i], nullptr);
-    vkDestroyFence(device.device(), inFlightFences[i], nullptr);
-  }
+  VkDevice deviceHandle = device.device();
+  const VkAllocationCallbacks *allocator = device.allocator();
+  LveDevice *lveDevice = &device;
+  device.deferDestruction(
+      [deviceHandle, allocator, lveDevice, swapChain = swapChain,
+       imageViews = std::move(swapChainImageViews),
+       framebuffers = std::move(swapChainFramebuffers),
+       renderPass = renderPass,
+       imageAvailable = std::move(imageAvailableSemaphores),
+       renderFinished = std::move(renderFinishedSemaphores),
+       fences = std::move(inFlightFences),
+       transferSemaphores = std::move(frameTransferSemaphores)]() mutable {
+        for (auto framebuffer : framebuffers) {
+          vkDestroyFramebuffer(deviceHandle, framebuffer, allocator);
+        }
+        if (renderPass != VK_NULL_HANDLE) {
+          vkDestroyRenderPass(deviceHandle, renderPass, allocator);
+        }
+        for (auto imageView : imageViews) {
+          vkDestroyImageView(deviceHandle, imageView, allocator);
+        }
+        if (swapChain != VK_NULL_HANDLE) {
+          vkDestroySwapchainKHR(deviceHandle, swapChain, allocator);
+        }
+        for (auto semaphore : imageAvailable) {
+          vkDestroySemaphore(deviceHandle, semaphore, allocator);
+        }
+        for (auto semaphore : renderFinished) {
+          vkDestroySemaphore(deviceHandle, semaphore, allocator);
+        }
+        for (auto fence : fences) {
+          vkDestroyFence(deviceHandle, fence, allocator);
+        }
+        for (auto &semaphores : transferSemaphores) {
+          lveDevice->recycleTransferSemaphores(semaphores);
+        }
+      });
 }
 
 VkResult LveSwapChain::acquireNextImage(uint32_t *imageIndex) {
-  vkWaitForFences(device.device(), 1, &inFlightFences[currentFrame], VK_TRUE,
-                  std::numeric_limits<uint64_t>::max());
+  auto waitStart = std::chrono::steady_clock::now();
+  if (timelineSync) {
+    device.waitForFrame(inFlightFrameSerials[currentFrame]);
+  } else {
+    vkWaitForFences(device.device(), 1, &inFlightFences[currentFrame], VK_TRUE,
+                    std::numeric_limits<uint64_t>::max());
+    device.markFrameCompleted(inFlightFrameSerials[currentFrame]);
+  }
+  frameTimings = FrameTimings{};
+  frameTimings.fenceWaitMs = std::chrono::duration<double, std::milli>(
+                                 std::chrono::steady_clock::now() - waitStart)
+                                 .count();
+  syncStats.waitMs += frameTimings.fenceWaitMs;
+  device.recycleTransferSemaphores(frameTransferSemaphores[currentFrame]);
+
+  if (headless) {
+    // one offscreen image per frame in flight, free once its fence signalled
+    *imageIndex = static_cast<uint32_t>(currentFrame % imageCount());
+    return VK_SUCCESS;
+  }
 
+  auto acquireStart = std::chrono::steady_clock::now();
   VkResult result = vkAcquireNextImageKHR(
       device.device(), swapChain, std::numeric_limits<uint64_t>::max(),
       imageAvailableSemaphores[currentFrame], // must be a not signaled
                                               // semaphore
       VK_NULL_HANDLE, imageIndex);
+  frameTimings.acquireMs = std::chrono::duration<double, std::milli>(
+                               std::chrono::steady_clock::now() - acquireStart)
+                               .count();
 
   return result;
 }
 
 VkResult LveSwapChain::submitCommandBuffers(const VkCommandBuffer *buffers,
                                             uint32_t *imageIndex) {
-  if (imagesInFlight[*imageIndex] != VK_NULL_HANDLE) {
-    vkWaitForFences(device.device(), 1, &imagesInFlight[*imageIndex], VK_TRUE,
-                    UINT64_MAX);
+  // an acquired image is already released by presentation and ordered by
+  // its semaphore, the timeline wait on this frame slot covers the rest
+  if (!timelineSync) {
+    if (imagesInFlight[*imageIndex] != VK_NULL_HANDLE) {
+      auto waitStart = std::chrono::steady_clock::now();
+      vkWaitForFences(device.device(), 1, &imagesInFlight[*imageIndex],
+                      VK_TRUE, UINT64_MAX);
+      double waitMs = std::chrono::duration<double, std::milli>(
+                          std::chrono::steady_clock::now() - waitStart)
+                          .count();
+      frameTimings.fenceWaitMs += waitMs;
+      syncStats.waitMs += waitMs;
+    }
+    imagesInFlight[*imageIndex] = inFlightFences[currentFrame];
   }
-  imagesInFlight[*imageIndex] = inFlightFences[currentFrame];
+  syncStats.frameCount++;
 
   VkSubmitInfo submitInfo = {};
   submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
-  VkSemaphore waitSemaphores[] = {imageAvailableSemaphores[currentFrame]};
-  VkPipelineStageFlags waitStages[] = {
-      VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-  submitInfo.waitSemaphoreCount = 1;
-  submitInfo.pWaitSemaphores = waitSemaphores;
-  submitInfo.pWaitDstStageMask = waitStages;
+  submitWaitSemaphores.clear();
+  submitWaitStages.clear();
+  if (!headless) {
+    submitWaitSemaphores.push_back(imageAvailableSemaphores[currentFrame]);
+    submitWaitStages.push_back(VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+  }
+
+  // only frames submitted after an upload wait on it
+  auto &transferSemaphores = frameTransferSemaphores[currentFrame];
+  device.takeTransferSemaphores(transferSemaphores);
+  for (auto semaphore : transferSemaphores) {
+    submitWaitSemaphores.push_back(semaphore);
+    submitWaitStages.push_back(VK_PIPELINE_STAGE_VERTEX_INPUT_BIT |
+                               VK_PIPELINE_STAGE_VERTEX_SHADER_BIT |
+                               VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+  }
+
+  submitInfo.waitSemaphoreCount =
+      static_cast<uint32_t>(submitWaitSemaphores.size());
+  submitInfo.pWaitSemaphores = submitWaitSemaphores.data();
+  submitInfo.pWaitDstStageMask = submitWaitStages.data();
 
   submitInfo.commandBufferCount = 1;
   submitInfo.pCommandBuffers = buffers;
 
-  VkSemaphore signalSemaphores[] = {renderFinishedSemaphores[currentFrame]};
-  submitInfo.signalSemaphoreCount = 1;
+  // binary semaphore values are ignored
+  VkSemaphore signalSemaphores[2];
+  uint64_t signalValues[2];
+  uint32_t signalCount = 0;
+  if (!headless) {
+    signalSemaphores[signalCount] = renderFinishedSemaphores[currentFrame];
+    signalValues[signalCount++] = 0;
+  }
+  if (timelineSync) {
+    signalSemaphores[signalCount] = device.frameTimelineSemaphore();
+    signalValues[signalCount++] = device.currentFrameSerial();
+  }
+  submitInfo.signalSemaphoreCount = signalCount;
   submitInfo.pSignalSemaphores = signalSemaphores;
 
-  vkResetFences(device.device(), 1, &inFlightFences[currentFrame]);
-  if (vkQueueSubmit(device.graphicsQueue(), 1, &submitInfo,
-                    inFlightFences[currentFrame]) != VK_SUCCESS) {
+  VkTimelineSemaphoreSubmitInfo timelineInfo{};
+  timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+  timelineInfo.signalSemaphoreValueCount = signalCount;
+  timelineInfo.pSignalSemaphoreValues = signalValues;
+
+  VkFence fence = VK_NULL_HANDLE;
+  if (timelineSync) {
+    submitInfo.pNext = &timelineInfo;
+  } else {
+    fence = inFlightFences[currentFrame];
+    vkResetFences(device.device(), 1, &fence);
+  }
+  if (vkQueueSubmit(device.graphicsQueue(), 1, &submitInfo, fence) !=
+      VK_SUCCESS) {
     throw std::runtime_error("failed to submit draw command buffer!");
   }
+  inFlightFrameSerials[currentFrame] = device.submitFrame();
+
+  if (headless) {
+    lastPresentTime = std::chrono::steady_clock::now();
+    if (!LveStartupProfiler::instance().isFinished()) {
+      LveStartupProfiler::instance().markFirstPresent();
+    }
+    currentFrame = (currentFrame + 1) % framesInFlight;
+    return VK_SUCCESS;
+  }
 
   VkPresentInfoKHR presentInfo = {};
   presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
 
   presentInfo.waitSemaphoreCount = 1;
-  presentInfo.pWaitSemaphores = signalSemaphores;
+  presentInfo.pWaitSemaphores = &renderFinishedSemaphores[currentFrame];
 
   VkSwapchainKHR swapChains[] = {swapChain};
   presentInfo.swapchainCount = 1;
@@ -122,9 +251,17 @@ VkResult LveSwapChain::submitCommandBuffers(const VkCommandBuffer *buffers,
 
   presentInfo.pImageIndices = imageIndex;
 
+  auto presentStart = std::chrono::steady_clock::now();
   auto result = vkQueuePresentKHR(device.presentQueue(), &presentInfo);
+  lastPresentTime = std::chrono::steady_clock::now();
+  frameTimings.presentMs =
+      std::chrono::duration<double, std::milli>(lastPresentTime - presentStart)
+          .count();
+  if (!LveStartupProfiler::instance().isFinished()) {
+    LveStartupProfiler::instance().markFirstPresent();
+  }
 
-  currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+  currentFrame = (currentFrame + 1) % framesInFlight;
 
   return result;
 }
@@ -134,8 +271,7 @@ void LveSwapChain::createSwapChain() {
 
   VkSurfaceFormatKHR surfaceFormat =
       chooseSwapSurfaceFormat(swapChainSupport.formats);
-  VkPresentModeKHR presentMode =
-      chooseSwapPresentMode(swapChainSupport.presentModes);
+  presentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
   VkExtent2D extent = chooseSwapExtent(swapChainSupport.capabilities);
 
   uint32_t imageCount = swapChainSupport.capabilities.minImageCount + 1;
@@ -154,6 +290,12 @@ void LveSwapChain::createSwapChain() {
   createInfo.imageExtent = extent;
   createInfo.imageArrayLayers = 1;
   createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+  // lets an offscreen scene be blitted in, e.g. for dynamic resolution
+  blitTarget = (swapChainSupport.capabilities.supportedUsageFlags &
+                VK_IMAGE_USAGE_TRANSFER_DST_BIT) != 0;
+  if (blitTarget) {
+    createInfo.imageUsage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+  }
 
   QueueFamilyIndices indices = device.findPhysicalQueueFamilies();
   uint32_t queueFamilyIndices[] = {indices.graphicsFamily,
@@ -178,8 +320,8 @@ void LveSwapChain::createSwapChain() {
   createInfo.oldSwapchain =
       oldSwapChain == nullptr ? VK_NULL_HANDLE : oldSwapChain->swapChain;
 
-  if (vkCreateSwapchainKHR(device.device(), &createInfo, nullptr, &swapChain) !=
-      VK_SUCCESS) {
+  if (vkCreateSwapchainKHR(device.device(), &createInfo, device.allocator(),
+                           &swapChain) != VK_SUCCESS) {
     throw std::runtime_error("failed to create swap chain!");
   }
 
@@ -197,6 +339,36 @@ void LveSwapChain::createSwapChain() {
   swapChainExtent = extent;
 }
 
+void LveSwapChain::createOffscreenImages() {
+  swapChainImageFormat = VK_FORMAT_B8G8R8A8_SRGB;
+  swapChainExtent = windowExtent;
+
+  swapChainImages.resize(framesInFlight);
+  offscreenImageMemorys.resize(framesInFlight);
+  for (size_t i = 0; i < swapChainImages.size(); i++) {
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.extent.width = swapChainExtent.width;
+    imageInfo.extent.height = swapChainExtent.height;
+    imageInfo.extent.depth = 1;
+    imageInfo.mipLevels = 1;
+    imageInfo.arrayLayers = 1;
+    imageInfo.format = swapChainImageFormat;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+                      VK_IMAGE_USAGE_TRANSFER_SRC_BIT |
+                      VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    imageInfo.flags = 0;
+
+    device.createImageWithInfo(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                               swapChainImages[i], offscreenImageMemorys[i]);
+  }
+}
+
 void LveSwapChain::createImageViews() {
   swapChainImageViews.resize(swapChainImages.size());
   for (size_t i = 0; i < swapChainImages.size(); i++) {
@@ -211,7 +383,7 @@ void LveSwapChain::createImageViews() {
     viewInfo.subresourceRange.baseArrayLayer = 0;
     viewInfo.subresourceRange.layerCount = 1;
 
-    if (vkCreateImageView(device.device(), &viewInfo, nullptr,
+    if (vkCreateImageView(device.device(), &viewInfo, device.allocator(),
                           &swapChainImageViews[i]) != VK_SUCCESS) {
       throw std::runtime_error("failed to create texture image view!");
     }
@@ -219,8 +391,15 @@ void LveSwapChain::createImageViews() {
 }
 
 void LveSwapChain::createRenderPass() {
+  // pipelines built against the previous chain stay compatible
+  if (oldSwapChain != nullptr && oldSwapChain->renderPass != VK_NULL_HANDLE &&
+      compareSwapFormats(*oldSwapChain)) {
+    renderPass = std::exchange(oldSwapChain->renderPass, VK_NULL_HANDLE);
+    return;
+  }
+
   VkAttachmentDescription depthAttachment{};
-  depthAttachment.format = findDepthFormat();
+  depthAttachment.format = swapChainDepthFormat;
   depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
   depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
   depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
@@ -242,7 +421,10 @@ void LveSwapChain::createRenderPass() {
   colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
   colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
   colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-  colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+  // offscreen targets are left ready to be copied out instead of presented
+  colorAttachment.finalLayout = headless
+                                    ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL
+                                    : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 
   VkAttachmentReference colorAttachmentRef = {};
   colorAttachmentRef.attachment = 0;
@@ -254,15 +436,20 @@ void LveSwapChain::createRenderPass() {
   subpass.pColorAttachments = &colorAttachmentRef;
   subpass.pDepthStencilAttachment = &depthAttachmentRef;
 
+  // the depth attachment is reused by the next frame in the same slot, so
+  // its clear has to wait for the previous frame's late depth writes
   VkSubpassDependency dependency = {};
   dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-  dependency.srcAccessMask = 0;
+  dependency.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
   dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT |
-                            VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+                            VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT |
+                            VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
   dependency.dstSubpass = 0;
   dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT |
-                            VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+                            VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT |
+                            VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
   dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+                             VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT |
                              VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
 
   std::array<VkAttachmentDescription, 2> attachments = {colorAttachment,
@@ -276,17 +463,25 @@ void LveSwapChain::createRenderPass() {
   renderPassInfo.dependencyCount = 1;
   renderPassInfo.pDependencies = &dependency;
 
-  if (vkCreateRenderPass(device.device(), &renderPassInfo, nullptr,
+  if (vkCreateRenderPass(device.device(), &renderPassInfo, device.allocator(),
                          &renderPass) != VK_SUCCESS) {
     throw std::runtime_error("failed to create render pass!");
   }
 }
 
+VkFramebuffer LveSwapChain::getFrameBuffer(int imageIndex, int frameIndex) {
+  if (swapChainFramebuffers.empty()) {
+    createFramebuffers();
+  }
+  return swapChainFramebuffers[frameIndex * imageCount() + imageIndex];
+}
+
 void LveSwapChain::createFramebuffers() {
-  swapChainFramebuffers.resize(imageCount());
-  for (size_t i = 0; i < imageCount(); i++) {
-    std::array<VkImageView, 2> attachments = {swapChainImageViews[i],
-                                              depthImageViews[i]};
+  swapChainFramebuffers.resize(framesInFlight * imageCount());
+  for (size_t i = 0; i < swapChainFramebuffers.size(); i++) {
+    std::array<VkImageView, 2> attachments = {
+        swapChainImageViews[i % imageCount()],
+        depthImageViews[i / imageCount()]};
 
     VkExtent2D swapChainExtent = getSwapChainExtent();
     VkFramebufferCreateInfo framebufferInfo = {};
@@ -298,7 +493,8 @@ void LveSwapChain::createFramebuffers() {
     framebufferInfo.height = swapChainExtent.height;
     framebufferInfo.layers = 1;
 
-    if (vkCreateFramebuffer(device.device(), &framebufferInfo, nullptr,
+    if (vkCreateFramebuffer(device.device(), &framebufferInfo,
+                            device.allocator(),
                             &swapChainFramebuffers[i]) != VK_SUCCESS) {
       throw std::runtime_error("failed to create framebuffer!");
     }
@@ -306,13 +502,31 @@ void LveSwapChain::createFramebuffers() {
 }
 
 void LveSwapChain::createDepthResources() {
-  VkFormat depthFormat = findDepthFormat();
-  swapChainDepthFormat = depthFormat;
+  VkFormat depthFormat = swapChainDepthFormat;
   VkExtent2D swapChainExtent = getSwapChainExtent();
 
-  depthImages.resize(imageCount());
-  depthImageMemorys.resize(imageCount());
-  depthImageViews.resize(imageCount());
+  // Attachments may be larger than the render area, so a shrinking window
+  // keeps the previous chain's depth images instead of allocating new ones.
+  if (oldSwapChain != nullptr &&
+      oldSwapChain->swapChainDepthFormat == depthFormat &&
+      oldSwapChain->depthImages.size() == framesInFlight &&
+      oldSwapChain->depthExtent.width >= swapChainExtent.width &&
+      oldSwapChain->depthExtent.height >= swapChainExtent.height) {
+    depthImages = std::move(oldSwapChain->depthImages);
+    depthImageMemorys = std::move(oldSwapChain->depthImageMemorys);
+    depthImageViews = std::move(oldSwapChain->depthImageViews);
+    depthExtent = oldSwapChain->depthExtent;
+    depthImageSize = oldSwapChain->depthImageSize;
+    oldSwapChain->depthImages.clear();
+    oldSwapChain->depthImageMemorys.clear();
+    oldSwapChain->depthImageViews.clear();
+    return;
+  }
+  depthExtent = swapChainExtent;
+
+  depthImages.resize(framesInFlight);
+  depthImageMemorys.resize(framesInFlight);
+  depthImageViews.resize(framesInFlight);
 
   for (int i = 0; i < depthImages.size(); i++) {
     VkImageCreateInfo imageInfo{};
@@ -333,6 +547,10 @@ void LveSwapChain::createDepthResources() {
 
     device.createImageWithInfo(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
                                depthImages[i], depthImageMemorys[i]);
+    VkMemoryRequirements memRequirements;
+    vkGetImageMemoryRequirements(device.device(), depthImages[i],
+                                 &memRequirements);
+    depthImageSize = memRequirements.size;
 
     VkImageViewCreateInfo viewInfo{};
     viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
@@ -345,18 +563,49 @@ void LveSwapChain::createDepthResources() {
     viewInfo.subresourceRange.baseArrayLayer = 0;
     viewInfo.subresourceRange.layerCount = 1;
 
-    if (vkCreateImageView(device.device(), &viewInfo, nullptr,
+    if (vkCreateImageView(device.device(), &viewInfo, device.allocator(),
                           &depthImageViews[i]) != VK_SUCCESS) {
       throw std::runtime_error("failed to create texture image view!");
     }
   }
+
+  // reported on startup and when the frame count changes, not on resizes
+  if (oldSwapChain == nullptr ||
+      oldSwapChain->framesInFlight != framesInFlight) {
+    double imageMb = static_cast<double>(depthImageSize) / (1024.0 * 1024.0);
+    double savedMb =
+        (static_cast<double>(imageCount()) - framesInFlight) * imageMb;
+    std::cout << "depth attachments: " << framesInFlight << " x " << imageMb
+              << " MB for " << imageCount() << " swap chain images, "
+              << savedMb << " MB saved over one per image" << std::endl;
+  }
 }
 
 void LveSwapChain::createSyncObjects() {
-  imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-  renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-  inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
+  // The previous chain's frames are still in flight in the same slots, so
+  // keep waiting on the same fences and serials rather than starting over.
+  if (oldSwapChain != nullptr &&
+      oldSwapChain->framesInFlight == framesInFlight) {
+    imageAvailableSemaphores =
+        std::exchange(oldSwapChain->imageAvailableSemaphores, {});
+    renderFinishedSemaphores =
+        std::exchange(oldSwapChain->renderFinishedSemaphores, {});
+    inFlightFences = std::exchange(oldSwapChain->inFlightFences, {});
+    frameTransferSemaphores =
+        std::exchange(oldSwapChain->frameTransferSemaphores, {});
+    inFlightFrameSerials = oldSwapChain->inFlightFrameSerials;
+    currentFrame = oldSwapChain->currentFrame;
+    imagesInFlight.assign(imageCount(), VK_NULL_HANDLE);
+    return;
+  }
+
+  imageAvailableSemaphores.resize(framesInFlight);
+  renderFinishedSemaphores.resize(framesInFlight);
+  // the frame timeline replaces the per frame fences
+  inFlightFences.resize(timelineSync ? 0 : framesInFlight);
   imagesInFlight.resize(imageCount(), VK_NULL_HANDLE);
+  frameTransferSemaphores.resize(framesInFlight);
+  inFlightFrameSerials.resize(framesInFlight, 0);
 
   VkSemaphoreCreateInfo semaphoreInfo = {};
   semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
@@ -365,13 +614,18 @@ void LveSwapChain::createSyncObjects() {
   fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
   fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
 
-  for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-    if (vkCreateSemaphore(device.device(), &semaphoreInfo, nullptr,
+  for (size_t i = 0; i < framesInFlight; i++) {
+    if (vkCreateSemaphore(device.device(), &semaphoreInfo, device.allocator(),
                           &imageAvailableSemaphores[i]) != VK_SUCCESS ||
-        vkCreateSemaphore(device.device(), &semaphoreInfo, nullptr,
-                          &renderFinishedSemaphores[i]) != VK_SUCCESS ||
-        vkCreateFence(device.device(), &fenceInfo, nullptr,
-                      &inFlightFences[i]) != VK_SUCCESS) {
+        vkCreateSemaphore(device.device(), &semaphoreInfo, device.allocator(),
+                          &renderFinishedSemaphores[i]) != VK_SUCCESS) {
+      throw std::runtime_error(
+          "failed to create synchronization objects for a frame!");
+    }
+  }
+  for (auto &fence : inFlightFences) {
+    if (vkCreateFence(device.device(), &fenceInfo, device.allocator(),
+                      &fence) != VK_SUCCESS) {
       throw std::runtime_error(
           "failed to create synchronization objects for a frame!");
     }
@@ -393,23 +647,32 @@ VkSurfaceFormatKHR LveSwapChain::chooseSwapSurfaceFormat(
 VkPresentModeKHR LveSwapChain::chooseSwapPresentMode(
     const std::vector<VkPresentModeKHR> &availablePresentModes) {
   for (const auto &availablePresentMode : availablePresentModes) {
-    if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR) {
-      std::cout << "Present mode: Mailbox" << std::endl;
+    if (availablePresentMode == preferredPresentMode) {
       return availablePresentMode;
     }
   }
 
-  // for (const auto &availablePresentMode : availablePresentModes) {
-  //   if (availablePresentMode == VK_PRESENT_MODE_IMMEDIATE_KHR) {
-  //     std::cout << "Present mode: Immediate" << std::endl;
-  //     return availablePresentMode;
-  //   }
-  //  }
-
-  std::cout << "Present mode: V-Sync" << std::endl;
+  std::cout << "Present mode " << presentModeName(preferredPresentMode)
+            << " is unavailable, using "
+            << presentModeName(VK_PRESENT_MODE_FIFO_KHR) << std::endl;
   return VK_PRESENT_MODE_FIFO_KHR;
 }
 
+const char *LveSwapChain::presentModeName(VkPresentModeKHR presentMode) {
+  switch (presentMode) {
+  case VK_PRESENT_MODE_IMMEDIATE_KHR:
+    return "immediate";
+  case VK_PRESENT_MODE_MAILBOX_KHR:
+    return "mailbox";
+  case VK_PRESENT_MODE_FIFO_KHR:
+    return "fifo";
+  case VK_PRESENT_MODE_FIFO_RELAXED_KHR:
+    return "fifo-relaxed";
+  default:
+    return "unknown";
+  }
+}
+
 VkExtent2D
 LveSwapChain::chooseSwapExtent(const VkSurfaceCapabilitiesKHR &capabilities) {
   if (capabilities.currentExtent.width !=
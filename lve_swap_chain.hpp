@@ -7,6 +7,7 @@
 #include <vulkan/vulkan.h>
 
 // std lib headers
+#include <chrono>
 #include <memory>
 #include <string>
 #include <vector>
@@ -15,10 +16,35 @@ namespace lve {
 
 class LveSwapChain {
 public:
-  static constexpr int MAX_FRAMES_IN_FLIGHT = 2;
-
-  LveSwapChain(LveDevice &deviceRef, VkExtent2D windowExtent);
+  static constexpr uint32_t DEFAULT_FRAMES_IN_FLIGHT = 2;
+  static constexpr uint32_t MAX_FRAMES_IN_FLIGHT = 4;
+
+  // cpu time spent blocked on earlier frames before a new one could be
+  // recorded or submitted
+  struct FrameSyncStats {
+    uint64_t frameCount = 0;
+    double waitMs = 0.0;
+
+    double averageWaitMs() const {
+      return frameCount == 0 ? 0.0 : waitMs / static_cast<double>(frameCount);
+    }
+  };
+
+  // CPU time the current or last frame spent blocked in the swap chain
+  struct FrameTimings {
+    double fenceWaitMs = 0.0;
+    double acquireMs = 0.0;
+    double presentMs = 0.0;
+  };
+
+  // falls back to FIFO, which every surface supports, when the preferred
+  // present mode is unavailable
+  LveSwapChain(
+      LveDevice &deviceRef, VkExtent2D windowExtent,
+      VkPresentModeKHR preferredPresentMode = VK_PRESENT_MODE_MAILBOX_KHR,
+      uint32_t framesInFlight = DEFAULT_FRAMES_IN_FLIGHT);
   LveSwapChain(LveDevice &deviceRef, VkExtent2D windowExtent,
+               VkPresentModeKHR preferredPresentMode, uint32_t framesInFlight,
                std::shared_ptr<LveSwapChain> previous);
 
   ~LveSwapChain();
@@ -26,11 +52,40 @@ public:
   LveSwapChain(const LveSwapChain &) = delete;
   LveSwapChain &operator=(const LveSwapChain &) = delete;
 
-  VkFramebuffer getFrameBuffer(int index) {
-    return swapChainFramebuffers[index];
-  }
+  // Only framesInFlight frames render at once, so depth attachments are
+  // allocated per frame in flight rather than per swap chain image and there
+  // is a framebuffer for every pairing of the two. Render graph passes bring
+  // their own, so these are only created by the first call.
+  VkFramebuffer getFrameBuffer(int imageIndex, int frameIndex);
+  // pipelines are built against it even when the frame is drawn by render
+  // graph passes, which are compatible
   VkRenderPass getRenderPass() { return renderPass; }
   VkImageView getImageView(int index) { return swapChainImageViews[index]; }
+  VkImage getImage(int index) { return swapChainImages[index]; }
+  VkImage getDepthImage(int frameIndex) { return depthImages[frameIndex]; }
+  VkImageView getDepthImageView(int frameIndex) {
+    return depthImageViews[frameIndex];
+  }
+  VkFormat getSwapChainDepthFormat() { return swapChainDepthFormat; }
+  // with dynamic rendering there is no render pass and no framebuffers
+  bool usesDynamicRendering() const { return dynamicRendering; }
+  // frames are paced on the device's frame timeline instead of fences
+  bool usesTimelineSync() const { return timelineSync; }
+  const FrameSyncStats &getFrameSyncStats() const { return syncStats; }
+  const FrameTimings &getFrameTimings() const { return frameTimings; }
+  // when vkQueuePresentKHR returned for the last frame, or when it was
+  // submitted for headless chains
+  std::chrono::steady_clock::time_point getLastPresentTime() const {
+    return lastPresentTime;
+  }
+  // headless chains render into engine-owned images that are never presented
+  bool isHeadless() const { return headless; }
+  // images can be the destination of a blit
+  bool isBlitTarget() const { return blitTarget; }
+  // number of frames the CPU may record ahead of the GPU
+  uint32_t getFramesInFlight() const { return framesInFlight; }
+  // the mode actually in use, headless chains report FIFO
+  VkPresentModeKHR getPresentMode() const { return presentMode; }
   size_t imageCount() { return swapChainImages.size(); }
   VkFormat getSwapChainImageFormat() { return swapChainImageFormat; }
   VkExtent2D getSwapChainExtent() { return swapChainExtent; }
@@ -42,6 +97,7 @@ public:
            static_cast<float>(swapChainExtent.height);
   }
   VkFormat findDepthFormat();
+  static const char *presentModeName(VkPresentModeKHR presentMode);
 
   VkResult acquireNextImage(uint32_t *imageIndex);
   VkResult submitCommandBuffers(const VkCommandBuffer *buffers,
@@ -55,6 +111,7 @@ public:
 private:
   void init();
   void createSwapChain();
+  void createOffscreenImages();
   void createImageViews();
   void createDepthResources();
   void createRenderPass();
@@ -73,25 +130,46 @@ private:
   VkExtent2D swapChainExtent;
 
   std::vector<VkFramebuffer> swapChainFramebuffers;
-  VkRenderPass renderPass;
+  VkRenderPass renderPass = VK_NULL_HANDLE;
 
   std::vector<VkImage> depthImages;
   std::vector<VkDeviceMemory> depthImageMemorys;
   std::vector<VkImageView> depthImageViews;
+  // may be larger than swapChainExtent when reused from a previous chain
+  VkExtent2D depthExtent{};
+  VkDeviceSize depthImageSize = 0;
   std::vector<VkImage> swapChainImages;
   std::vector<VkImageView> swapChainImageViews;
+  std::vector<VkDeviceMemory> offscreenImageMemorys;
 
   LveDevice &device;
   VkExtent2D windowExtent;
-
-  VkSwapchainKHR swapChain;
+  VkPresentModeKHR preferredPresentMode;
+  VkPresentModeKHR presentMode = VK_PRESENT_MODE_FIFO_KHR;
+  uint32_t framesInFlight;
+
+  VkSwapchainKHR swapChain = VK_NULL_HANDLE;
+  bool headless;
+  bool dynamicRendering;
+  bool blitTarget = true;
+  bool timelineSync;
+  FrameSyncStats syncStats{};
+  FrameTimings frameTimings{};
+  std::chrono::steady_clock::time_point lastPresentTime{};
   std::shared_ptr<LveSwapChain> oldSwapChain;
 
   std::vector<VkSemaphore> imageAvailableSemaphores;
   std::vector<VkSemaphore> renderFinishedSemaphores;
   std::vector<VkFence> inFlightFences;
   std::vector<VkFence> imagesInFlight;
+  std::vector<uint64_t> inFlightFrameSerials;
   size_t currentFrame = 0;
+
+  // upload semaphores waited on by each frame in flight, returned to the
+  // device once that frame's fence has signalled
+  std::vector<std::vector<VkSemaphore>> frameTransferSemaphores;
+  std::vector<VkSemaphore> submitWaitSemaphores;
+  std::vector<VkPipelineStageFlags> submitWaitStages;
 };
 
 } // namespace lve
@@ -0,0 +1,601 @@
+#include "lve_texture.hpp"
+
+#include "lve_buffer.hpp"
+
+// libs
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+// std
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <stdexcept>
+
+namespace lve {
+
+static constexpr VkFormat TEXTURE_FORMAT = VK_FORMAT_R8G8B8A8_SRGB;
+// swaps free their old set a few frames later, so leave room for those
+static constexpr uint32_t MAX_TEXTURE_SETS = 1024;
+
+LveTexture::LveTexture(LveDevice &device, const std::string &filepath,
+                       VkSampler sampler)
+    : lveDevice{device}, filepath{filepath}, sampler{sampler} {}
+
+LveTexture::~LveTexture() {
+  if (image != VK_NULL_HANDLE) {
+    lveDevice.destroyImageDeferred(image, imageView, imageMemory);
+  }
+}
+
+VkDescriptorImageInfo LveTexture::descriptorInfo() const {
+  VkDescriptorImageInfo imageInfo{};
+  imageInfo.sampler = sampler;
+  imageInfo.imageView = imageView;
+  imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+  return imageInfo;
+}
+
+void LveTexture::markVisible(float distance) {
+  viewDistance = std::min(viewDistance, distance);
+}
+
+LveTexture::MipLevelData LveTexture::decode(const std::string &filepath) {
+  int texWidth, texHeight, texChannels;
+  stbi_uc *decodedPixels = stbi_load(filepath.c_str(), &texWidth, &texHeight,
+                                     &texChannels, STBI_rgb_alpha);
+  if (!decodedPixels) {
+    throw std::runtime_error("failed to load texture image: " + filepath);
+  }
+
+  MipLevelData data{};
+  data.baseLevel = 0;
+  data.width = static_cast<uint32_t>(texWidth);
+  data.height = static_cast<uint32_t>(texHeight);
+  data.pixels.assign(decodedPixels,
+                     decodedPixels + data.width * data.height * 4);
+  stbi_image_free(decodedPixels);
+  return data;
+}
+
+void LveTexture::setSource(MipLevelData &&source, uint32_t minResidentSize) {
+  width = source.width;
+  height = source.height;
+  pixels = std::move(source.pixels);
+  mipLevels = static_cast<uint32_t>(
+                  std::floor(std::log2(std::max(width, height)))) +
+              1;
+
+  tailLevel = 0;
+  while (tailLevel + 1 < mipLevels &&
+         std::max(width >> tailLevel, height >> tailLevel) > minResidentSize) {
+    tailLevel++;
+  }
+  residentBaseLevel = tailLevel;
+  targetBaseLevel = tailLevel;
+  decoded = true;
+}
+
+// box filters level 0 straight down to the requested level, runs on a worker
+LveTexture::MipLevelData LveTexture::downsample(uint32_t level) const {
+  MipLevelData data{};
+  data.baseLevel = level;
+  data.width = std::max(1u, width >> level);
+  data.height = std::max(1u, height >> level);
+  if (level == 0) {
+    data.pixels = pixels;
+    return data;
+  }
+
+  data.pixels.resize(data.width * data.height * 4);
+  for (uint32_t y = 0; y < data.height; y++) {
+    uint32_t y0 = y * height / data.height;
+    uint32_t y1 = std::max(y0 + 1, (y + 1) * height / data.height);
+    for (uint32_t x = 0; x < data.width; x++) {
+      uint32_t x0 = x * width / data.width;
+      uint32_t x1 = std::max(x0 + 1, (x + 1) * width / data.width);
+
+      uint32_t sum[4] = {0, 0, 0, 0};
+      for (uint32_t sy = y0; sy < y1; sy++) {
+        const unsigned char *row = &pixels[(sy * width + x0) * 4];
+        for (uint32_t sx = x0; sx < x1; sx++, row += 4) {
+          sum[0] += row[0];
+          sum[1] += row[1];
+          sum[2] += row[2];
+          sum[3] += row[3];
+        }
+      }
+
+      uint32_t count = (y1 - y0) * (x1 - x0);
+      unsigned char *out = &data.pixels[(y * data.width + x) * 4];
+      for (int c = 0; c < 4; c++) {
+        out[c] = static_cast<unsigned char>(sum[c] / count);
+      }
+    }
+  }
+  return data;
+}
+
+VkDeviceSize LveTexture::levelBytes(uint32_t baseLevel) const {
+  VkDeviceSize bytes = 0;
+  for (uint32_t level = baseLevel; level < mipLevels; level++) {
+    bytes += static_cast<VkDeviceSize>(std::max(1u, width >> level)) *
+             std::max(1u, height >> level) * 4;
+  }
+  return bytes;
+}
+
+void LveTexture::makeResident(VkImage newImage, VkDeviceMemory newImageMemory,
+                              VkImageView newImageView, uint32_t baseLevel,
+                              VkDeviceSize bytes) {
+  if (image != VK_NULL_HANDLE) {
+    lveDevice.destroyImageDeferred(image, imageView, imageMemory);
+  }
+  image = newImage;
+  imageMemory = newImageMemory;
+  imageView = newImageView;
+  residentBaseLevel = baseLevel;
+  residentBytes = bytes;
+  generation++;
+  loadInFlight = false;
+}
+
+LveTextureManager::LveTextureManager(LveDevice &device,
+                                     LveThreadPool &threadPool,
+                                     const TextureStreamingConfig &config)
+    : lveDevice{device}, threadPool{threadPool}, config{config} {
+  // mips are generated with linear blits
+  lveDevice.findSupportedFormat(
+      {TEXTURE_FORMAT}, VK_IMAGE_TILING_OPTIMAL,
+      VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT |
+          VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT);
+  createSampler();
+
+  setLayout = LveDescriptorSetLayout::Builder(lveDevice)
+                  .addBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                              VK_SHADER_STAGE_FRAGMENT_BIT)
+                  .build();
+  descriptorPool =
+      LveDescriptorPool::Builder(lveDevice)
+          .setMaxSets(MAX_TEXTURE_SETS)
+          .setPoolFlags(VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT)
+          .addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                       MAX_TEXTURE_SETS)
+          .build();
+  createDefaultTexture();
+}
+
+LveTextureManager::~LveTextureManager() {
+  // workers read the source pixels of the textures they were given
+  for (auto &load : pendingLoads) {
+    load.data.wait();
+  }
+
+  VkDevice device = lveDevice.device();
+  VkSampler sampler = this->sampler;
+  const VkAllocationCallbacks *allocator = lveDevice.allocator();
+  lveDevice.deferDestruction([device, sampler, allocator]() {
+    vkDestroySampler(device, sampler, allocator);
+  });
+  // the last reference to the pool goes with the frames still binding its
+  // sets
+  std::shared_ptr<LveDescriptorPool> pool = std::move(descriptorPool);
+  lveDevice.deferDestruction([pool]() {});
+}
+
+void LveTextureManager::createSampler() {
+  VkSamplerCreateInfo samplerInfo{};
+  samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+  samplerInfo.magFilter = VK_FILTER_LINEAR;
+  samplerInfo.minFilter = VK_FILTER_LINEAR;
+  samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+  samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+  samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+  samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+  samplerInfo.anisotropyEnable = VK_FALSE;
+  samplerInfo.maxAnisotropy = 1.0f;
+  samplerInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
+  samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
+  samplerInfo.minLod = 0.0f;
+  // resident images hold a varying number of levels
+  samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+
+  if (vkCreateSampler(lveDevice.device(), &samplerInfo, lveDevice.allocator(),
+                      &sampler) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create texture sampler!");
+  }
+}
+
+void LveTextureManager::createDefaultTexture() {
+  LveTexture::MipLevelData texel{0, 1, 1, {255, 255, 255, 255}};
+  defaultTexture = std::make_shared<LveTexture>(lveDevice, "", sampler);
+  defaultTexture->setSource(LveTexture::MipLevelData{texel},
+                            config.minResidentSize);
+  defaultTexture->loadInFlight = true;
+  uploadLevel(defaultTexture, texel);
+  // a single texel, waiting for it keeps every draw bindable from the first
+  // frame on
+  lveDevice.waitIdle();
+  writeDescriptorSet(*defaultTexture);
+}
+
+void LveTextureManager::writeDescriptorSet(LveTexture &texture) {
+  if (texture.descriptorSet != VK_NULL_HANDLE) {
+    freeDescriptorSet(texture.descriptorSet);
+  }
+  // a new set instead of an update, the old one may be bound by frames in
+  // flight
+  VkDescriptorImageInfo imageInfo = texture.descriptorInfo();
+  if (!LveDescriptorWriter(*setLayout, *descriptorPool)
+           .writeImage(0, &imageInfo)
+           .build(texture.descriptorSet)) {
+    throw std::runtime_error("failed to allocate texture descriptor set!");
+  }
+  texture.descriptorGeneration = texture.generation;
+}
+
+void LveTextureManager::freeDescriptorSet(VkDescriptorSet descriptorSet) {
+  std::shared_ptr<LveDescriptorPool> pool = descriptorPool;
+  lveDevice.deferDestruction([pool, descriptorSet]() {
+    std::vector<VkDescriptorSet> descriptorSets{descriptorSet};
+    pool->freeDescriptors(descriptorSets);
+  });
+}
+
+std::shared_ptr<LveTexture>
+LveTextureManager::loadTexture(const std::string &filepath) {
+  auto texture = std::make_shared<LveTexture>(lveDevice, filepath, sampler);
+  texture->loadInFlight = true;
+  pendingLoads.push_back(
+      {texture, threadPool.submit([filepath]() {
+         return LveTexture::decode(filepath);
+       })});
+  textures.push_back(texture);
+  return texture;
+}
+
+void LveTextureManager::update() {
+  collectLoads();
+
+  // nobody but the manager references these any more
+  auto unused = std::partition(textures.begin(), textures.end(),
+                               [](const std::shared_ptr<LveTexture> &t) {
+                                 return t.use_count() > 1 || t->loadInFlight;
+                               });
+  for (auto it = unused; it != textures.end(); ++it) {
+    if ((*it)->descriptorSet != VK_NULL_HANDLE) {
+      freeDescriptorSet((*it)->descriptorSet);
+    }
+  }
+  textures.erase(unused, textures.end());
+
+  // images swapped since the last update
+  for (auto &texture : textures) {
+    if (texture->isResident() &&
+        (texture->descriptorSet == VK_NULL_HANDLE ||
+         texture->descriptorGeneration != texture->generation)) {
+      writeDescriptorSet(*texture);
+    }
+  }
+
+  planResidency();
+}
+
+void LveTextureManager::collectLoads() {
+  auto it = pendingLoads.begin();
+  while (it != pendingLoads.end()) {
+    if (it->data.wait_for(std::chrono::seconds(0)) !=
+        std::future_status::ready) {
+      ++it;
+      continue;
+    }
+
+    auto texture = it->texture;
+    LveTexture::MipLevelData data;
+    try {
+      data = it->data.get();
+    } catch (const std::exception &e) {
+      // an untextured object draws with the default texture, a resident one
+      // keeps the levels it already has
+      std::cerr << "texture: failed to load " << texture->getFilepath() << ": "
+                << e.what() << std::endl;
+      it = pendingLoads.erase(it);
+      texture->loadInFlight = false;
+      texture->loadFailed = true;
+      continue;
+    }
+    it = pendingLoads.erase(it);
+
+    if (!texture->decoded) {
+      // start with the coarse tail, finer levels stream in from there
+      texture->setSource(std::move(data), config.minResidentSize);
+      requestLevel(texture, texture->tailLevel);
+    } else {
+      uploadLevel(texture, data);
+    }
+  }
+}
+
+uint32_t LveTextureManager::desiredBaseLevel(const LveTexture &texture) const {
+  if (!std::isfinite(texture.viewDistance)) {
+    return texture.tailLevel;
+  }
+  float ratio = texture.viewDistance / config.fullDetailDistance;
+  if (ratio <= 1.f) {
+    return 0;
+  }
+  return std::min(static_cast<uint32_t>(std::log2(ratio)), texture.tailLevel);
+}
+
+void LveTextureManager::planResidency() {
+  std::vector<std::shared_ptr<LveTexture>> candidates;
+  uint32_t loadsInFlight = 0;
+  VkDeviceSize plannedBytes = 0;
+  for (auto &texture : textures) {
+    if (texture->loadInFlight) {
+      loadsInFlight++;
+    }
+    if (texture->isResident()) {
+      texture->targetBaseLevel = desiredBaseLevel(*texture);
+      plannedBytes += texture->levelBytes(texture->targetBaseLevel);
+      candidates.push_back(texture);
+    }
+  }
+  requestedBytes = plannedBytes;
+
+  // over budget, drop the finest levels of the farthest textures first
+  std::sort(candidates.begin(), candidates.end(),
+            [](const std::shared_ptr<LveTexture> &a,
+               const std::shared_ptr<LveTexture> &b) {
+              return a->viewDistance > b->viewDistance;
+            });
+  for (auto &texture : candidates) {
+    while (plannedBytes > config.budgetBytes &&
+           texture->targetBaseLevel < texture->tailLevel) {
+      plannedBytes -= texture->levelBytes(texture->targetBaseLevel) -
+                      texture->levelBytes(texture->targetBaseLevel + 1);
+      texture->targetBaseLevel++;
+    }
+    if (plannedBytes <= config.budgetBytes) {
+      break;
+    }
+  }
+
+  // evictions free memory so they go first, then textures stream in one
+  // level at a time, coarsest first and nearest first among equals
+  std::vector<std::shared_ptr<LveTexture>> promotions;
+  for (auto &texture : candidates) {
+    if (texture->loadInFlight || texture->loadFailed) {
+      continue;
+    }
+    if (texture->targetBaseLevel > texture->residentBaseLevel) {
+      if (loadsInFlight < config.maxLoadsInFlight) {
+        loadsInFlight++;
+        requestLevel(texture, texture->targetBaseLevel);
+      }
+    } else if (texture->targetBaseLevel < texture->residentBaseLevel) {
+      promotions.push_back(texture);
+    }
+  }
+
+  std::sort(promotions.begin(), promotions.end(),
+            [](const std::shared_ptr<LveTexture> &a,
+               const std::shared_ptr<LveTexture> &b) {
+              if (a->residentBaseLevel != b->residentBaseLevel) {
+                return a->residentBaseLevel > b->residentBaseLevel;
+              }
+              return a->viewDistance < b->viewDistance;
+            });
+  for (auto &texture : promotions) {
+    if (loadsInFlight >= config.maxLoadsInFlight) {
+      break;
+    }
+    loadsInFlight++;
+    requestLevel(texture, texture->residentBaseLevel - 1);
+  }
+
+  for (auto &texture : textures) {
+    texture->viewDistance = std::numeric_limits<float>::infinity();
+  }
+}
+
+void LveTextureManager::requestLevel(
+    const std::shared_ptr<LveTexture> &texture, uint32_t baseLevel) {
+  texture->loadInFlight = true;
+  const LveTexture *source = texture.get();
+  pendingLoads.push_back(
+      {texture, threadPool.submit([source, baseLevel]() {
+         return source->downsample(baseLevel);
+       })});
+}
+
+void LveTextureManager::uploadLevel(const std::shared_ptr<LveTexture> &texture,
+                                    LveTexture::MipLevelData &data) {
+  uint32_t levels = texture->mipLevels - data.baseLevel;
+
+  auto stagingBuffer = std::make_shared<LveBuffer>(
+      lveDevice, data.pixels.size(), 1, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+          VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+  stagingBuffer->map();
+  stagingBuffer->writeToBuffer(data.pixels.data());
+
+  VkImageCreateInfo imageInfo{};
+  imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+  imageInfo.imageType = VK_IMAGE_TYPE_2D;
+  imageInfo.extent.width = data.width;
+  imageInfo.extent.height = data.height;
+  imageInfo.extent.depth = 1;
+  imageInfo.mipLevels = levels;
+  imageInfo.arrayLayers = 1;
+  imageInfo.format = TEXTURE_FORMAT;
+  imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+  imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  imageInfo.usage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT |
+                    VK_IMAGE_USAGE_TRANSFER_DST_BIT |
+                    VK_IMAGE_USAGE_SAMPLED_BIT;
+  imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+  imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+  VkImage image;
+  VkDeviceMemory imageMemory;
+  lveDevice.createImageWithInfo(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                image, imageMemory);
+
+  VkMemoryRequirements memRequirements;
+  vkGetImageMemoryRequirements(lveDevice.device(), image, &memRequirements);
+
+  VkImageViewCreateInfo viewInfo{};
+  viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+  viewInfo.image = image;
+  viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+  viewInfo.format = TEXTURE_FORMAT;
+  viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  viewInfo.subresourceRange.baseMipLevel = 0;
+  viewInfo.subresourceRange.levelCount = levels;
+  viewInfo.subresourceRange.baseArrayLayer = 0;
+  viewInfo.subresourceRange.layerCount = 1;
+
+  VkImageView imageView;
+  if (vkCreateImageView(lveDevice.device(), &viewInfo, lveDevice.allocator(),
+                        &imageView) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create texture image view!");
+  }
+
+  VkCommandBuffer commandBuffer = lveDevice.beginSingleTimeCommands();
+
+  VkImageMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.image = image;
+  barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  barrier.subresourceRange.baseMipLevel = 0;
+  barrier.subresourceRange.levelCount = levels;
+  barrier.subresourceRange.baseArrayLayer = 0;
+  barrier.subresourceRange.layerCount = 1;
+  barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+  barrier.srcAccessMask = 0;
+  barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                       VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0,
+                       nullptr, 1, &barrier);
+
+  VkBufferImageCopy region{};
+  region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  region.imageSubresource.mipLevel = 0;
+  region.imageSubresource.baseArrayLayer = 0;
+  region.imageSubresource.layerCount = 1;
+  region.imageOffset = {0, 0, 0};
+  region.imageExtent = {data.width, data.height, 1};
+  vkCmdCopyBufferToImage(commandBuffer, stagingBuffer->getBuffer(), image,
+                         VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+  // each level is blitted from the previous one, which then becomes readable
+  // by the fragment shader
+  barrier.subresourceRange.levelCount = 1;
+  int32_t mipWidth = static_cast<int32_t>(data.width);
+  int32_t mipHeight = static_cast<int32_t>(data.height);
+  for (uint32_t i = 1; i < levels; i++) {
+    barrier.subresourceRange.baseMipLevel = i - 1;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0,
+                         nullptr, 1, &barrier);
+
+    int32_t nextWidth = mipWidth > 1 ? mipWidth / 2 : 1;
+    int32_t nextHeight = mipHeight > 1 ? mipHeight / 2 : 1;
+
+    VkImageBlit blit{};
+    blit.srcOffsets[0] = {0, 0, 0};
+    blit.srcOffsets[1] = {mipWidth, mipHeight, 1};
+    blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    blit.srcSubresource.mipLevel = i - 1;
+    blit.srcSubresource.baseArrayLayer = 0;
+    blit.srcSubresource.layerCount = 1;
+    blit.dstOffsets[0] = {0, 0, 0};
+    blit.dstOffsets[1] = {nextWidth, nextHeight, 1};
+    blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    blit.dstSubresource.mipLevel = i;
+    blit.dstSubresource.baseArrayLayer = 0;
+    blit.dstSubresource.layerCount = 1;
+    vkCmdBlitImage(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                   image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit,
+                   VK_FILTER_LINEAR);
+
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr,
+                         0, nullptr, 1, &barrier);
+
+    mipWidth = nextWidth;
+    mipHeight = nextHeight;
+  }
+
+  barrier.subresourceRange.baseMipLevel = levels - 1;
+  barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+  barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0,
+                       nullptr, 1, &barrier);
+
+  // the old image stays in use until the new one is complete, it is then
+  // retired through the deferred deletion queue
+  uint32_t baseLevel = data.baseLevel;
+  VkDeviceSize bytes = memRequirements.size;
+  lveDevice.submitGraphicsCommands(
+      commandBuffer, [texture, stagingBuffer, image, imageMemory, imageView,
+                      baseLevel, bytes]() mutable {
+        stagingBuffer.reset();
+        texture->makeResident(image, imageMemory, imageView, baseLevel, bytes);
+      });
+}
+
+LveTextureManager::Stats LveTextureManager::getStats() const {
+  Stats stats{};
+  stats.textureCount = static_cast<uint32_t>(textures.size());
+  stats.requestedBytes = requestedBytes;
+  stats.budgetBytes = config.budgetBytes;
+  for (auto &texture : textures) {
+    if (!texture->decoded && !texture->loadFailed) {
+      stats.decodingCount++;
+    } else if (texture->loadInFlight) {
+      stats.loadingCount++;
+    }
+    if (texture->isResident()) {
+      stats.residentCount++;
+      stats.residentBytes += texture->residentBytes;
+      if (texture->residentBaseLevel == 0) {
+        stats.fullResolutionCount++;
+      }
+    }
+  }
+  return stats;
+}
+
+void LveTextureManager::printStats() const {
+  Stats stats = getStats();
+  const double mib = 1024.0 * 1024.0;
+  char line[256];
+  std::snprintf(line, sizeof(line),
+                "textures: %u/%u resident, %u full resolution, %u decoding, "
+                "%u loading, %.1f/%.1f MiB (requested %.1f MiB)",
+                stats.residentCount, stats.textureCount,
+                stats.fullResolutionCount, stats.decodingCount,
+                stats.loadingCount, stats.residentBytes / mib,
+                stats.budgetBytes / mib, stats.requestedBytes / mib);
+  std::cout << line << std::endl;
+}
+
+} // namespace lve
@@ -0,0 +1,180 @@
+#pragma once
+
+#include "lve_descriptors.hpp"
+#include "lve_device.hpp"
+#include "lve_thread_pool.hpp"
+
+// std
+#include <future>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace lve {
+
+struct TextureStreamingConfig {
+  // device memory the resident mip levels of all textures may use
+  VkDeviceSize budgetBytes = 256 * 1024 * 1024;
+  // textures closer than this get their full resolution, every doubling of
+  // the distance drops one mip level
+  float fullDetailDistance = 4.f;
+  // the coarse mip tail up to this size is always resident once loaded
+  uint32_t minResidentSize = 64;
+  // residency changes being decoded or uploaded at the same time
+  uint32_t maxLoadsInFlight = 2;
+};
+
+class LveTexture {
+public:
+  LveTexture(LveDevice &device, const std::string &filepath,
+             VkSampler sampler);
+  ~LveTexture();
+
+  LveTexture(const LveTexture &) = delete;
+  LveTexture &operator=(const LveTexture &) = delete;
+
+  // false until the mip tail has been decoded and uploaded
+  bool isResident() const { return imageView != VK_NULL_HANDLE; }
+  VkDescriptorImageInfo descriptorInfo() const;
+  // changes whenever the resident image is swapped, descriptor sets
+  // referencing the texture have to be rewritten when it does
+  uint32_t getGeneration() const { return generation; }
+  // VK_NULL_HANDLE until the manager's update after the texture first became
+  // resident, replaced by a new set on every later swap
+  VkDescriptorSet getDescriptorSet() const { return descriptorSet; }
+
+  const std::string &getFilepath() const { return filepath; }
+  uint32_t getWidth() const { return width; }
+  uint32_t getHeight() const { return height; }
+  uint32_t getMipLevels() const { return mipLevels; }
+  uint32_t getResidentBaseLevel() const { return residentBaseLevel; }
+  VkDeviceSize getResidentBytes() const { return residentBytes; }
+
+  // distance from the camera of an object drawn with this texture in the
+  // current frame, the closest use wins
+  void markVisible(float distance);
+
+private:
+  friend class LveTextureManager;
+
+  // rgba8 pixels of baseLevel, the finest level of an upload
+  struct MipLevelData {
+    uint32_t baseLevel;
+    uint32_t width;
+    uint32_t height;
+    std::vector<unsigned char> pixels;
+  };
+
+  static MipLevelData decode(const std::string &filepath);
+  void setSource(MipLevelData &&source, uint32_t minResidentSize);
+  MipLevelData downsample(uint32_t level) const;
+  VkDeviceSize levelBytes(uint32_t baseLevel) const;
+  void makeResident(VkImage newImage, VkDeviceMemory newImageMemory,
+                    VkImageView newImageView, uint32_t baseLevel,
+                    VkDeviceSize bytes);
+
+  LveDevice &lveDevice;
+  std::string filepath;
+  VkSampler sampler;
+
+  // decoded level 0, kept as the source for streaming finer mips back in
+  std::vector<unsigned char> pixels;
+  uint32_t width = 0;
+  uint32_t height = 0;
+  uint32_t mipLevels = 0;
+  uint32_t tailLevel = 0;
+  bool decoded = false;
+
+  VkImage image = VK_NULL_HANDLE;
+  VkDeviceMemory imageMemory = VK_NULL_HANDLE;
+  VkImageView imageView = VK_NULL_HANDLE;
+  uint32_t residentBaseLevel = 0;
+  VkDeviceSize residentBytes = 0;
+  uint32_t generation = 0;
+  VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+  uint32_t descriptorGeneration = 0;
+
+  bool loadInFlight = false;
+  // a decode or downsample threw, the texture keeps what it has
+  bool loadFailed = false;
+  uint32_t targetBaseLevel = 0;
+  float viewDistance = std::numeric_limits<float>::infinity();
+};
+
+// Decodes textures on worker threads and streams their mip levels in
+// coarse-to-fine, keeping the resident levels of all textures within the
+// memory budget by dropping the finest levels of the farthest textures.
+class LveTextureManager {
+public:
+  struct Stats {
+    uint32_t textureCount = 0;
+    uint32_t residentCount = 0;
+    uint32_t fullResolutionCount = 0;
+    uint32_t decodingCount = 0;
+    uint32_t loadingCount = 0;
+    VkDeviceSize residentBytes = 0;
+    // what the textures would need at their distance-based level, before
+    // the budget is applied
+    VkDeviceSize requestedBytes = 0;
+    VkDeviceSize budgetBytes = 0;
+  };
+
+  LveTextureManager(
+      LveDevice &device, LveThreadPool &threadPool,
+      const TextureStreamingConfig &config = TextureStreamingConfig{});
+  ~LveTextureManager();
+
+  LveTextureManager(const LveTextureManager &) = delete;
+  LveTextureManager &operator=(const LveTextureManager &) = delete;
+
+  std::shared_ptr<LveTexture> loadTexture(const std::string &filepath);
+
+  // every texture set has its combined image sampler at binding 0
+  VkDescriptorSetLayout getDescriptorSetLayout() const {
+    return setLayout->getDescriptorSetLayout();
+  }
+  // a white texel, bound in place of missing or not yet resident textures
+  VkDescriptorSet getDefaultDescriptorSet() const {
+    return defaultTexture->descriptorSet;
+  }
+
+  // call once per frame after the frame's textures have been marked visible
+  void update();
+
+  Stats getStats() const;
+  void printStats() const;
+
+private:
+  struct PendingLoad {
+    std::shared_ptr<LveTexture> texture;
+    std::future<LveTexture::MipLevelData> data;
+  };
+
+  void createSampler();
+  void createDefaultTexture();
+  void writeDescriptorSet(LveTexture &texture);
+  void freeDescriptorSet(VkDescriptorSet descriptorSet);
+  void collectLoads();
+  void planResidency();
+  uint32_t desiredBaseLevel(const LveTexture &texture) const;
+  void requestLevel(const std::shared_ptr<LveTexture> &texture,
+                    uint32_t baseLevel);
+  void uploadLevel(const std::shared_ptr<LveTexture> &texture,
+                   LveTexture::MipLevelData &data);
+
+  LveDevice &lveDevice;
+  LveThreadPool &threadPool;
+  TextureStreamingConfig config;
+  VkSampler sampler;
+  std::unique_ptr<LveDescriptorSetLayout> setLayout;
+  // shared with the deferred frees of sets frames in flight may still bind
+  std::shared_ptr<LveDescriptorPool> descriptorPool;
+  std::shared_ptr<LveTexture> defaultTexture;
+
+  std::vector<std::shared_ptr<LveTexture>> textures;
+  std::vector<PendingLoad> pendingLoads;
+  VkDeviceSize requestedBytes = 0;
+};
+
+} // namespace lve
@@ -0,0 +1,57 @@
+#include "lve_thread_pool.hpp"
+
+namespace lve {
+
+LveThreadPool::LveThreadPool(uint32_t threadCount) {
+  for (uint32_t i = 0; i < threadCount; i++) {
+    workers.emplace_back([this]() { workerLoop(); });
+  }
+}
+
+LveThreadPool::~LveThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock{mutex};
+    stopping = true;
+  }
+  condition.notify_all();
+  for (auto &worker : workers) {
+    worker.join();
+  }
+}
+
+uint32_t LveThreadPool::defaultThreadCount() {
+  uint32_t hardwareThreads = std::thread::hardware_concurrency();
+  return hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+}
+
+void LveThreadPool::enqueue(std::function<void()> job, Priority priority) {
+  {
+    std::lock_guard<std::mutex> lock{mutex};
+    if (priority == Priority::High) {
+      jobs.push_front(std::move(job));
+    } else {
+      jobs.push_back(std::move(job));
+    }
+  }
+  condition.notify_one();
+}
+
+void LveThreadPool::workerLoop() {
+  while (true) {
+    std::function<void()> job;
+    {
+      std::unique_lock<std::mutex> lock{mutex};
+      condition.wait(lock, [this]() { return stopping || !jobs.empty(); });
+      // queued jobs are drained before shutting down so no future is left
+      // without a result
+      if (jobs.empty()) {
+        return;
+      }
+      job = std::move(jobs.front());
+      jobs.pop_front();
+    }
+    job();
+  }
+}
+
+} // namespace lve
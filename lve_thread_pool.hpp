@@ -0,0 +1,55 @@
+#pragma once
+
+// std
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace lve {
+
+class LveThreadPool {
+public:
+  // high priority jobs (per-frame work) run before queued background jobs
+  enum class Priority { Normal, High };
+
+  explicit LveThreadPool(uint32_t threadCount = defaultThreadCount());
+  ~LveThreadPool();
+
+  LveThreadPool(const LveThreadPool &) = delete;
+  LveThreadPool &operator=(const LveThreadPool &) = delete;
+
+  // Runs task on a worker thread, exceptions are rethrown from future.get().
+  template <typename F>
+  auto submit(F &&task, Priority priority = Priority::Normal)
+      -> std::future<decltype(task())> {
+    using Result = decltype(task());
+    auto packagedTask =
+        std::make_shared<std::packaged_task<Result()>>(std::forward<F>(task));
+    std::future<Result> future = packagedTask->get_future();
+    enqueue([packagedTask]() { (*packagedTask)(); }, priority);
+    return future;
+  }
+
+  uint32_t threadCount() const { return static_cast<uint32_t>(workers.size()); }
+
+  // one worker per hardware thread, leaving one for the main thread
+  static uint32_t defaultThreadCount();
+
+private:
+  void enqueue(std::function<void()> job, Priority priority);
+  void workerLoop();
+
+  std::vector<std::thread> workers;
+  std::deque<std::function<void()>> jobs;
+  std::mutex mutex;
+  std::condition_variable condition;
+  bool stopping = false;
+};
+
+} // namespace lve
@@ -1,18 +1,26 @@
 #include "lve_window.hpp"
+#include "lve_startup_profiler.hpp"
 #include <GLFW/glfw3.h>
 #include <stdexcept>
 
 namespace lve {
-LveWindow::LveWindow(int w, int h, std::string name)
-    : width{w}, height{h}, windowName{name} {
-  initWindow();
+LveWindow::LveWindow(int w, int h, std::string name, bool headless)
+    : width{w}, height{h}, headless{headless}, windowName{name} {
+  // headless windows only carry the render extent, glfw is never touched
+  if (!headless) {
+    initWindow();
+  }
 }
 LveWindow::~LveWindow() {
+  if (headless) {
+    return;
+  }
   glfwDestroyWindow(window);
   glfwTerminate();
 }
 
 void LveWindow::initWindow() {
+  LveStartupProfiler::Scope profile{"LveWindow::initWindow"};
   glfwInit();
   glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
   glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
@@ -24,8 +32,12 @@ void LveWindow::initWindow() {
 }
 
 void LveWindow::createWindowSurface(VkInstance instance,
+                                    const VkAllocationCallbacks *allocator,
                                     VkSurfaceKHR *surface) {
-  if (glfwCreateWindowSurface(instance, window, nullptr, surface) !=
+  if (headless) {
+    throw std::runtime_error("cannot create a surface for a headless window");
+  }
+  if (glfwCreateWindowSurface(instance, window, allocator, surface) !=
       VK_SUCCESS) {
     throw std::runtime_error("failed to create a window surface");
   }
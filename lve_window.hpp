@@ -10,22 +10,27 @@
 namespace lve {
 class LveWindow {
 public:
-  LveWindow(int w, int h, std::string name);
+  LveWindow(int w, int h, std::string name, bool headless = false);
   ~LveWindow();
 
   // Removes dangling pointer
   LveWindow(const LveWindow &) = delete;
   LveWindow &operator=(const LveWindow &) = delete;
 
-  bool shouldClose() { return glfwWindowShouldClose(window); }
+  bool shouldClose() {
+    return !headless && glfwWindowShouldClose(window);
+  }
   VkExtent2D getExtent() {
     return {static_cast<uint32_t>(width), static_cast<uint32_t>(height)};
   }
   bool wasWindowResized() { return frameBufferResized; }
   void resetWindowResizedFlag() { frameBufferResized = false; }
   GLFWwindow *getGLFWwindo() const { return window; }
+  bool isHeadless() const { return headless; }
 
-  void createWindowSurface(VkInstance instance, VkSurfaceKHR *surface);
+  void createWindowSurface(VkInstance instance,
+                           const VkAllocationCallbacks *allocator,
+                           VkSurfaceKHR *surface);
 
 private:
   static void frameBufferResizedCallback(GLFWwindow *window, int width,
@@ -35,8 +40,9 @@ private:
   int width;
   int height;
   bool frameBufferResized = false;
+  bool headless = false;
 
   std::string windowName;
-  GLFWwindow *window;
+  GLFWwindow *window = nullptr;
 };
 } // namespace lve
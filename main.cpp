@@ -1,11 +1,91 @@
 #include "first_app.hpp"
+#include "lve_startup_profiler.hpp"
 
+#include <algorithm>
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <stdexcept>
 
-int main() {
-  lve::FirstApp app{};
+static bool parsePresentMode(const char *name, VkPresentModeKHR &mode) {
+  for (VkPresentModeKHR candidate :
+       {VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_MAILBOX_KHR,
+        VK_PRESENT_MODE_FIFO_KHR, VK_PRESENT_MODE_FIFO_RELAXED_KHR}) {
+    if (std::strcmp(name, lve::LveSwapChain::presentModeName(candidate)) ==
+        0) {
+      mode = candidate;
+      return true;
+    }
+  }
+  return false;
+}
+
+int main(int argc, char **argv) {
+  lve::LveStartupProfiler::instance().start();
+
+  lve::FirstAppConfig config{};
+  for (int i = 1; i < argc; i++) {
+    if (std::strcmp(argv[i], "--headless") == 0) {
+      config.headless = true;
+    } else if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+      config.frameCount = static_cast<uint32_t>(std::atoi(argv[++i]));
+    } else if (std::strcmp(argv[i], "--dynamic-rendering") == 0) {
+      config.dynamicRendering = true;
+    } else if (std::strcmp(argv[i], "--timeline-sync") == 0) {
+      config.timelineSync = true;
+    } else if (std::strcmp(argv[i], "--pipeline-stats") == 0) {
+      config.pipelineStatistics = true;
+    } else if (std::strcmp(argv[i], "--no-command-arena") == 0) {
+      config.commandArena = false;
+    } else if (std::strcmp(argv[i], "--present-mode") == 0 && i + 1 < argc &&
+               parsePresentMode(argv[i + 1], config.presentMode)) {
+      i++;
+    } else if (std::strcmp(argv[i], "--fps-cap") == 0 && i + 1 < argc) {
+      config.targetFps = std::atof(argv[++i]);
+    } else if (std::strcmp(argv[i], "--frames-in-flight") == 0 &&
+               i + 1 < argc) {
+      int framesInFlight = std::atoi(argv[++i]);
+      config.framesInFlight = static_cast<uint32_t>(std::clamp(
+          framesInFlight, 1, int(lve::LveSwapChain::MAX_FRAMES_IN_FLIGHT)));
+    } else if (std::strcmp(argv[i], "--capture") == 0) {
+      config.captureFrames = true;
+    } else if (std::strcmp(argv[i], "--capture-shm") == 0 && i + 1 < argc) {
+      config.captureFrames = true;
+      config.captureShmName = argv[++i];
+    } else if (std::strcmp(argv[i], "--depth-prepass") == 0) {
+      config.depthPrepass = true;
+    } else if (std::strcmp(argv[i], "--frame-stats") == 0 && i + 1 < argc) {
+      config.frameStatsCsv = argv[++i];
+    } else if (std::strcmp(argv[i], "--low-latency") == 0) {
+      config.lowLatency = true;
+    } else if (std::strcmp(argv[i], "--lights") == 0 && i + 1 < argc) {
+      config.lightCount = static_cast<uint32_t>(
+          std::clamp(std::atoi(argv[++i]), 0, int(lve::MAX_LIGHTS)));
+    } else if (std::strcmp(argv[i], "--unlit") == 0) {
+      config.unlit = true;
+    } else if (std::strcmp(argv[i], "--dynamic-resolution") == 0) {
+      config.dynamicResolution = true;
+    } else if (std::strcmp(argv[i], "--render-scale") == 0 && i + 1 < argc) {
+      config.renderScale = static_cast<float>(std::atof(argv[++i]));
+    } else {
+      std::cerr << "usage: " << argv[0] << " [--headless] [--frames N]"
+                << " [--dynamic-rendering] [--timeline-sync]"
+                << " [--pipeline-stats] [--no-command-arena]"
+                << " [--present-mode immediate|mailbox|fifo|fifo-relaxed]"
+                << " [--fps-cap FPS] [--frames-in-flight N]"
+                << " [--capture] [--capture-shm NAME] [--depth-prepass]"
+                << " [--dynamic-resolution] [--render-scale S]"
+                << " [--low-latency] [--frame-stats CSV]"
+                << " [--lights N] [--unlit]\n";
+      return EXIT_FAILURE;
+    }
+  }
+  // without a window nothing would ever stop the loop
+  if (config.headless && config.frameCount == 0) {
+    config.frameCount = 1000;
+  }
+
+  lve::FirstApp app{config};
 
   try {
     app.run();
@@ -0,0 +1,19 @@
+#version 450
+
+layout(location = 0) in vec3 position;
+
+layout(set = 0, binding = 0) uniform GlobalUbo{
+  mat4 projectionViewMatrix;
+} ubo;
+
+layout(push_constant) uniform Push {
+  mat4 modelMatrix;
+} push;
+
+// computed exactly like shader.vert
+invariant gl_Position;
+
+void main() {
+  vec4 positionWorld = push.modelMatrix * vec4(position, 1.0);
+  gl_Position = ubo.projectionViewMatrix * positionWorld;
+}
@@ -1,8 +1,12 @@
 #version 450
 
 layout (location = 0) in vec3 fragColor;
+layout (location = 1) in vec2 fragUv;
 layout (location = 0) out vec4 outColor;
 
+// untextured objects bind a white texel
+layout(set = 1, binding = 0) uniform sampler2D texSampler;
+
 layout(push_constant) uniform Push {
   mat4 modelMatrix;
   mat4 normalMatrix;
@@ -11,5 +15,5 @@ layout(push_constant) uniform Push {
 
 
 void main() {
-  outColor = vec4(fragColor, 1.0);
+  outColor = vec4(fragColor, 1.0) * texture(texSampler, fragUv);
 }
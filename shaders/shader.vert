@@ -1,17 +1,34 @@
 #version 450
 
+// specialization constants, each pipeline variant only pays for its lighting
+// 0 is unlit vertex color, 1 is ambient plus lambert diffuse point lights
+layout(constant_id = 0) const int LIGHTING_MODEL = 1;
+// point lights read from the ubo, at most MAX_LIGHTS
+layout(constant_id = 1) const int LIGHT_COUNT = 1;
+
+const int MAX_LIGHTS = 4;
+
 layout(location = 0) in vec3 position;
 layout(location = 1) in vec3 color;
 layout(location = 2) in vec3 normal;
 layout(location = 3) in vec2 uv;
 
 layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec2 fragUv;
+
+// must match depth.vert bit for bit, the color pass tests EQUAL against the
+// depth pre-pass
+invariant gl_Position;
+
+struct PointLight {
+  vec4 position; // w is ignored
+  vec4 color; // w is intensity
+};
 
 layout(set = 0, binding = 0) uniform GlobalUbo{
   mat4 projectionViewMatrix;
   vec4 ambientLightColor;
-  vec3 lightPosition;
-  vec4 lightColor;
+  PointLight pointLights[MAX_LIGHTS];
 } ubo;
 
 layout(push_constant) uniform Push {
@@ -23,15 +40,22 @@ layout(push_constant) uniform Push {
 void main() {
   vec4 positionWorld = push.modelMatrix * vec4(position, 1.0);
   gl_Position = ubo.projectionViewMatrix * positionWorld;
-  
-  vec3 normalWorldSpace = normalize(mat3(push.normalMatrix) * normal);
+  fragUv = uv;
+
+  if (LIGHTING_MODEL == 0) {
+    fragColor = color;
+  } else {
+    vec3 normalWorldSpace = normalize(mat3(push.normalMatrix) * normal);
+
+    vec3 diffuseLight = ubo.ambientLightColor.xyz * ubo.ambientLightColor.w;
+    for (int i = 0; i < LIGHT_COUNT; i++) {
+      vec3 directionToLight = ubo.pointLights[i].position.xyz - positionWorld.xyz;
+      float attenuation = 1.0 / dot(directionToLight, directionToLight); //distance squared
 
-  vec3 directionToLight = ubo.lightPosition - positionWorld.xyz;
-  float attenuation = 1.0 / dot(directionToLight, directionToLight); //distance squared
-  
-  vec3 lightColor = ubo.lightColor.xyz * ubo.lightColor.w * attenuation;
-  vec3 ambientLight = ubo.ambientLightColor.xyz * ubo.ambientLightColor.w;
-  vec3 diffuseLight = lightColor * max(dot(normalWorldSpace, normalize(directionToLight)), 0);
+      vec3 lightColor = ubo.pointLights[i].color.xyz * ubo.pointLights[i].color.w * attenuation;
+      diffuseLight += lightColor * max(dot(normalWorldSpace, normalize(directionToLight)), 0);
+    }
 
-  fragColor = (diffuseLight + ambientLight) * color;
+    fragColor = diffuseLight * color;
+  }
 }
@@ -7,6 +7,7 @@
 #include <vulkan/vulkan_core.h>
 
 #include <array>
+#include <iostream>
 #include <stdexcept>
 
 #define GLM_FORCE_RADIANS
@@ -22,19 +23,34 @@ struct SimplePushConstantData {
 };
 
 SimpleRenderSystem::SimpleRenderSystem(LveDevice &device,
-                                       VkRenderPass renderPass,
-                                       VkDescriptorSetLayout globalSetLayout)
-    : lveDevice{device} {
-  createPipelineLayout(globalSetLayout);
-  createPipeline(renderPass);
+                                       LvePipelineCompiler &pipelineCompiler,
+                                       const PipelineTargetInfo &target,
+                                       VkDescriptorSetLayout globalSetLayout,
+                                       LveTextureManager &textureManager,
+                                       const ShadingFeatures &features)
+    : lveDevice{device}, textureManager{textureManager},
+      colorPipelines{pipelineCompiler, "shaders/vert.spv", "shaders/frag.spv"},
+      depthPipelines{pipelineCompiler, "shaders/depth_vert.spv", ""},
+      target{target} {
+  createPipelineLayout(globalSetLayout,
+                       textureManager.getDescriptorSetLayout());
+  setShadingFeatures(features);
+  // nothing to draw with in the meantime
+  colorVariant = pendingColorVariant;
+  equalVariant = pendingEqualVariant;
 }
 
 SimpleRenderSystem::~SimpleRenderSystem() {
-  vkDestroyPipelineLayout(lveDevice.device(), pipelineLayout, nullptr);
+  // the workers still use the layout while compiling
+  colorPipelines.wait();
+  depthPipelines.wait();
+  vkDestroyPipelineLayout(lveDevice.device(), pipelineLayout,
+                          lveDevice.allocator());
 }
 
 void SimpleRenderSystem::createPipelineLayout(
-    VkDescriptorSetLayout globalSetLayout) {
+    VkDescriptorSetLayout globalSetLayout,
+    VkDescriptorSetLayout textureSetLayout) {
 
   VkPushConstantRange pushConstantRange{};
   pushConstantRange.stageFlags =
@@ -42,7 +58,8 @@ void SimpleRenderSystem::createPipelineLayout(
   pushConstantRange.offset = 0;
   pushConstantRange.size = sizeof(SimplePushConstantData);
 
-  std::vector<VkDescriptorSetLayout> descriptorSetLayouts{globalSetLayout};
+  std::vector<VkDescriptorSetLayout> descriptorSetLayouts{globalSetLayout,
+                                                         textureSetLayout};
 
   VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
   pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
@@ -51,44 +68,196 @@ void SimpleRenderSystem::createPipelineLayout(
   pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts.data();
   pipelineLayoutInfo.pushConstantRangeCount = 1;
   pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
-  if (vkCreatePipelineLayout(lveDevice.device(), &pipelineLayoutInfo, nullptr,
+  if (vkCreatePipelineLayout(lveDevice.device(), &pipelineLayoutInfo,
+                             lveDevice.allocator(),
                              &pipelineLayout) != VK_SUCCESS) {
     throw std::runtime_error("failed to create pipeline layout");
   }
 }
 
-void SimpleRenderSystem::createPipeline(VkRenderPass renderPass) {
+std::unique_ptr<PipelineConfigInfo>
+SimpleRenderSystem::createColorConfig(bool depthEqual) const {
   assert(pipelineLayout != nullptr &&
          "Cannot create pipeline before pipeline layout");
 
-  PipelineConfigInfo pipelineConfig{};
-  LvePipeline::defaultPipelineConfigInfo(pipelineConfig);
-  pipelineConfig.renderPass = renderPass;
-  pipelineConfig.pipelineLayout = pipelineLayout;
-  lvePipeline = std::make_unique<LvePipeline>(
-      lveDevice, "shaders/vert.spv", "shaders/frag.spv", pipelineConfig);
+  auto pipelineConfig = std::make_unique<PipelineConfigInfo>();
+  LvePipeline::defaultPipelineConfigInfo(*pipelineConfig);
+  pipelineConfig->target = target;
+  pipelineConfig->pipelineLayout = pipelineLayout;
+  // the depth pre-pass leaves exactly the visible surface in the buffer
+  if (depthEqual) {
+    pipelineConfig->depthStencilInfo.depthWriteEnable = VK_FALSE;
+    pipelineConfig->depthStencilInfo.depthCompareOp = VK_COMPARE_OP_EQUAL;
+  }
+  LvePipeline::setSpecializationConstant(
+      *pipelineConfig, LIGHTING_MODEL_CONSTANT,
+      static_cast<uint32_t>(shadingFeatures.lightingModel));
+  LvePipeline::setSpecializationConstant(
+      *pipelineConfig, LIGHT_COUNT_CONSTANT, shadingFeatures.lightCount);
+  return pipelineConfig;
+}
+
+void SimpleRenderSystem::requestColorVariants() {
+  pendingColorVariant = colorPipelines.request(createColorConfig(false));
+  pendingEqualVariant =
+      depthPrepass ? colorPipelines.request(createColorConfig(true))
+                   : LvePipelineVariants::NO_VARIANT;
+}
+
+LvePipeline &SimpleRenderSystem::getColorPipeline() {
+  if (colorPipelines.ready(pendingColorVariant)) {
+    colorVariant = pendingColorVariant;
+  }
+  if (pendingEqualVariant != LvePipelineVariants::NO_VARIANT &&
+      colorPipelines.ready(pendingEqualVariant)) {
+    equalVariant = pendingEqualVariant;
+  }
+  return colorPipelines.get(depthPrepass ? equalVariant : colorVariant);
+}
+
+void SimpleRenderSystem::setShadingFeatures(const ShadingFeatures &features) {
+  shadingFeatures = features;
+  shadingFeatures.lightCount = std::min(features.lightCount, MAX_LIGHTS);
+  requestColorVariants();
+}
+
+void SimpleRenderSystem::setDepthPrepass(
+    bool enabled, const PipelineTargetInfo &depthTarget) {
+  depthPrepass = enabled;
+  // the graph may have recreated its render passes, a new one can reuse the
+  // handle of the one the old variant was built against
+  if (depthVariant != LvePipelineVariants::NO_VARIANT) {
+    depthPipelines.release(depthVariant);
+    depthVariant = LvePipelineVariants::NO_VARIANT;
+  }
+  if (!enabled) {
+    return;
+  }
+  if (pendingEqualVariant == LvePipelineVariants::NO_VARIANT) {
+    pendingEqualVariant = colorPipelines.request(createColorConfig(true));
+  }
+  // the first pre-pass has no EQUAL variant to draw with meanwhile
+  if (equalVariant == LvePipelineVariants::NO_VARIANT) {
+    equalVariant = pendingEqualVariant;
+  }
+  // position only, the depth shader has no specialization constants
+  auto depthConfig = std::make_unique<PipelineConfigInfo>();
+  LvePipeline::defaultPipelineConfigInfo(*depthConfig);
+  depthConfig->target = depthTarget;
+  depthConfig->pipelineLayout = pipelineLayout;
+  depthConfig->attributeDescriptions =
+      LveModel::Vertex::getPositionAttributeDescriptions();
+  depthConfig->colorBlendInfo.attachmentCount = 0;
+  depthVariant = depthPipelines.request(std::move(depthConfig));
 }
 
 void SimpleRenderSystem::renderGameObjects(
     FrameInfo &frameInfo, std::vector<LveGameObject> &gameObjects) {
-  lvePipeline->bind(frameInfo.commandBuffer);
+  LvePipeline &pipeline = getColorPipeline();
+  drawCount = 0;
+  submittedVertexCount = 0;
+  LveGpuProfiler::Scope profile{frameInfo.gpuProfiler, frameInfo.commandBuffer,
+                                "SimpleRenderSystem"};
+  LveGpuProfiler::StatisticsScope statistics{
+      frameInfo.gpuProfiler, frameInfo.commandBuffer, "SimpleRenderSystem"};
+  recordGameObjects(frameInfo.commandBuffer, frameInfo, pipeline, gameObjects,
+                    0, gameObjects.size(), true);
+}
+
+void SimpleRenderSystem::renderGameObjectsParallel(
+    FrameInfo &frameInfo, std::vector<LveGameObject> &gameObjects,
+    LveRenderer &renderer) {
+  LvePipeline &pipeline = getColorPipeline();
+  drawCount = 0;
+  submittedVertexCount = 0;
+  renderer.recordParallel(
+      frameInfo.commandBuffer, gameObjects.size(),
+      [&](VkCommandBuffer commandBuffer, size_t begin, size_t end) {
+        recordGameObjects(commandBuffer, frameInfo, pipeline, gameObjects,
+                          begin, end, true);
+      },
+      "SimpleRenderSystem");
+}
+
+void SimpleRenderSystem::renderDepthPrepassParallel(
+    FrameInfo &frameInfo, std::vector<LveGameObject> &gameObjects,
+    LveRenderer &renderer) {
+  assert(depthPrepass && "depth pre-pass is not enabled");
+  LvePipeline &pipeline = depthPipelines.get(depthVariant);
+  renderer.recordParallel(
+      frameInfo.commandBuffer, gameObjects.size(),
+      [&](VkCommandBuffer commandBuffer, size_t begin, size_t end) {
+        recordGameObjects(commandBuffer, frameInfo, pipeline, gameObjects,
+                          begin, end, false);
+      },
+      "SimpleRenderSystem depth");
+}
+
+void SimpleRenderSystem::recordGameObjects(
+    VkCommandBuffer commandBuffer, FrameInfo &frameInfo, LvePipeline &pipeline,
+    std::vector<LveGameObject> &gameObjects, size_t begin, size_t end,
+    bool textured) {
+  pipeline.bind(commandBuffer);
 
-  vkCmdBindDescriptorSets(frameInfo.commandBuffer,
-                          VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1,
-                          &frameInfo.globalDescriptorSet, 0, nullptr);
+  vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                          pipelineLayout, 0, 1, &frameInfo.globalDescriptorSet,
+                          0, nullptr);
 
-  for (auto &obj : gameObjects) {
+  uint64_t vertices = 0;
+  VkDescriptorSet boundTextureSet = VK_NULL_HANDLE;
+  for (size_t i = begin; i < end; i++) {
+    auto &obj = gameObjects[i];
+    // the depth pre-pass has no fragment shader to sample with
+    if (textured) {
+      VkDescriptorSet textureSet =
+          obj.texture && obj.texture->getDescriptorSet() != VK_NULL_HANDLE
+              ? obj.texture->getDescriptorSet()
+              : textureManager.getDefaultDescriptorSet();
+      if (textureSet != boundTextureSet) {
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                pipelineLayout, 1, 1, &textureSet, 0, nullptr);
+        boundTextureSet = textureSet;
+      }
+    }
     SimplePushConstantData push;
     push.modelMatrix = obj.transform.mat4();
     push.normalMatrix = obj.transform.normalMatrix();
 
-    vkCmdPushConstants(frameInfo.commandBuffer, pipelineLayout,
+    vkCmdPushConstants(commandBuffer, pipelineLayout,
                        VK_SHADER_STAGE_VERTEX_BIT |
                            VK_SHADER_STAGE_FRAGMENT_BIT,
                        0, sizeof(SimplePushConstantData), &push);
-    obj.model->bind(frameInfo.commandBuffer);
-    obj.model->draw(frameInfo.commandBuffer);
+    obj.model->bind(commandBuffer);
+    obj.model->draw(commandBuffer);
+    vertices += obj.model->getVertexCount();
+  }
+  drawCount += end - begin;
+  submittedVertexCount += vertices;
+}
+
+void SimpleRenderSystem::printStats(const LveGpuProfiler &profiler) const {
+  std::cout << "SimpleRenderSystem: " << drawCount << " draws, "
+            << submittedVertexCount << " unique vertices";
+  const auto &allStatistics = profiler.getPipelineStatistics();
+  auto found = allStatistics.find("SimpleRenderSystem");
+  if (found != allStatistics.end()) {
+    // anything above one invocation per unique vertex is post-transform
+    // cache misses or vertices shared between draws
+    uint64_t invocations = found->second.vertexShaderInvocations;
+    uint64_t wasted = invocations > submittedVertexCount
+                          ? invocations - submittedVertexCount
+                          : 0;
+    std::cout << ", " << invocations << " vs invocations (" << wasted
+              << " wasted), " << found->second.fragmentShaderInvocations
+              << " fs invocations";
+  }
+  // the pre-pass has no fragment shader, its cost is the extra vertex work
+  auto depth = allStatistics.find("SimpleRenderSystem depth");
+  if (depthPrepass && depth != allStatistics.end()) {
+    std::cout << ", depth pre-pass " << depth->second.vertexShaderInvocations
+              << " vs invocations";
   }
+  std::cout << std::endl;
 }
 
 } // namespace lve
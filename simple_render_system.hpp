@@ -5,8 +5,13 @@
 #include "lve_device.hpp"
 #include "lve_frame_info.hpp"
 #include "lve_pipeline.hpp"
+#include "lve_pipeline_compiler.hpp"
+#include "lve_pipeline_variants.hpp"
+#include "lve_renderer.hpp"
+#include "lve_texture.hpp"
 
 #include <algorithm>
+#include <atomic>
 #include <memory>
 #include <vector>
 #include <vulkan/vulkan_core.h>
@@ -14,8 +19,21 @@
 namespace lve {
 class SimpleRenderSystem {
 public:
-  SimpleRenderSystem(LveDevice &device, VkRenderPass renderPass,
-                     VkDescriptorSetLayout globalSetLayout);
+  enum class LightingModel : uint32_t { Unlit = 0, Lambert = 1 };
+
+  // Baked into the pipelines through shader.vert's specialization constants,
+  // every combination is a pipeline variant of its own.
+  struct ShadingFeatures {
+    LightingModel lightingModel = LightingModel::Lambert;
+    // point lights read from the global ubo, at most MAX_LIGHTS
+    uint32_t lightCount = 1;
+  };
+
+  SimpleRenderSystem(LveDevice &device, LvePipelineCompiler &pipelineCompiler,
+                     const PipelineTargetInfo &target,
+                     VkDescriptorSetLayout globalSetLayout,
+                     LveTextureManager &textureManager,
+                     const ShadingFeatures &features);
   ~SimpleRenderSystem();
 
   SimpleRenderSystem(const SimpleRenderSystem &) = delete;
@@ -23,14 +41,78 @@ public:
 
   void renderGameObjects(FrameInfo &frameInfo,
                          std::vector<LveGameObject> &gameObjects);
+  // records the draw list across the renderer's worker threads, the render
+  // pass has to have been begun for secondary command buffers
+  void renderGameObjectsParallel(FrameInfo &frameInfo,
+                                 std::vector<LveGameObject> &gameObjects,
+                                 LveRenderer &renderer);
+
+  // With a depth pre-pass the color pass compares EQUAL against the depth the
+  // pre-pass wrote and does not write depth itself, so every pixel is shaded
+  // once. The EQUAL color variant and the depth only pipeline, built against
+  // depthTarget, are only requested once the pre-pass is enabled.
+  void setDepthPrepass(bool enabled,
+                       const PipelineTargetInfo &depthTarget = {});
+  bool usesDepthPrepass() const { return depthPrepass; }
+  // position only, has to run in the pre-pass before the color pass
+  void renderDepthPrepassParallel(FrameInfo &frameInfo,
+                                  std::vector<LveGameObject> &gameObjects,
+                                  LveRenderer &renderer);
+
+  // A combination not used before compiles in the background, render calls
+  // keep drawing with the previous one until it is ready. Only the first
+  // render call after construction waits.
+  void setShadingFeatures(const ShadingFeatures &features);
+  const ShadingFeatures &getShadingFeatures() const { return shadingFeatures; }
+
+  // draws and vertices submitted by the last render call next to the
+  // profiler's pipeline statistics, which trail by the frames in flight
+  void printStats(const LveGpuProfiler &profiler) const;
 
 private:
-  void createPipelineLayout(VkDescriptorSetLayout globalSetLayout);
-  void createPipeline(VkRenderPass renderPass);
+  void recordGameObjects(VkCommandBuffer commandBuffer, FrameInfo &frameInfo,
+                         LvePipeline &pipeline,
+                         std::vector<LveGameObject> &gameObjects, size_t begin,
+                         size_t end, bool textured);
+
+  // constant_ids in shader.vert
+  static constexpr uint32_t LIGHTING_MODEL_CONSTANT = 0;
+  static constexpr uint32_t LIGHT_COUNT_CONSTANT = 1;
+
+  void createPipelineLayout(VkDescriptorSetLayout globalSetLayout,
+                            VkDescriptorSetLayout textureSetLayout);
+  std::unique_ptr<PipelineConfigInfo> createColorConfig(bool depthEqual) const;
+  void requestColorVariants();
+  // switches to the requested variants that finished compiling
+  LvePipeline &getColorPipeline();
 
   LveDevice &lveDevice;
+  LveTextureManager &textureManager;
 
-  std::unique_ptr<LvePipeline> lvePipeline;
+  // compiled in the background, taken on first use
+  LvePipelineVariants colorPipelines;
+  LvePipelineVariants depthPipelines;
+  // what the current features use, the color pass after a depth pre-pass
+  // compares EQUAL
+  LvePipelineVariants::VariantId colorVariant = 0;
+  LvePipelineVariants::VariantId equalVariant =
+      LvePipelineVariants::NO_VARIANT;
+  // requested by the last setShadingFeatures, still compiling, no EQUAL
+  // variant while the pre-pass is off
+  LvePipelineVariants::VariantId pendingColorVariant = 0;
+  LvePipelineVariants::VariantId pendingEqualVariant =
+      LvePipelineVariants::NO_VARIANT;
+  // built against the graph's current pre-pass, released when that changes
+  LvePipelineVariants::VariantId depthVariant =
+      LvePipelineVariants::NO_VARIANT;
+
+  PipelineTargetInfo target;
+  ShadingFeatures shadingFeatures{};
   VkPipelineLayout pipelineLayout;
+  bool depthPrepass = false;
+
+  // written by the recording threads
+  std::atomic<uint64_t> drawCount{0};
+  std::atomic<uint64_t> submittedVertexCount{0};
 };
 } // namespace lve
@@ -0,0 +1,139 @@
+// Compiles a render graph on a headless device and checks what it planned:
+// which passes are culled, the barriers in front of each pass and which
+// transient images share memory.
+//
+// build and run with `make check`
+
+#include "../lve_device.hpp"
+#include "../lve_render_graph.hpp"
+#include "../lve_renderer.hpp"
+#include "../lve_thread_pool.hpp"
+#include "../lve_window.hpp"
+
+// std
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <string>
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, const std::string &what) {
+  if (!condition) {
+    std::printf("FAIL: %s\n", what.c_str());
+    failures++;
+  }
+}
+
+void checkBarrier(const lve::LveRenderGraph::Barrier &barrier,
+                  lve::LveRenderGraph::ResourceId resource,
+                  VkImageLayout oldLayout, VkImageLayout newLayout,
+                  const std::string &what) {
+  check(barrier.resource == resource, what + " transitions the right image");
+  check(barrier.oldLayout == oldLayout, what + " old layout");
+  check(barrier.newLayout == newLayout, what + " new layout");
+}
+
+void testGraph(lve::LveDevice &device, lve::LveRenderer &renderer) {
+  using Graph = lve::LveRenderGraph;
+  Graph graph{device, renderer};
+  auto noop = [](VkCommandBuffer) {};
+  Graph::ImageDesc color{renderer.getSwapChainImageFormat()};
+
+  // a and c are never alive at the same time, b overlaps both
+  auto backbuffer = graph.importSwapChainImage("backbuffer");
+  auto a = graph.createImage("a", color);
+  auto b = graph.createImage("b", color);
+  auto c = graph.createImage("c", color);
+  auto unused = graph.createImage("unused", color);
+
+  auto passA = graph.addPass("write a", noop);
+  passA.writeColor(a, VK_ATTACHMENT_LOAD_OP_CLEAR);
+  auto passB = graph.addPass("a to b", noop);
+  passB.sample(a).writeColor(b, VK_ATTACHMENT_LOAD_OP_CLEAR);
+  auto passC = graph.addPass("b to c", noop);
+  passC.sample(b).writeColor(c, VK_ATTACHMENT_LOAD_OP_CLEAR);
+  // loads its own output, which nothing reads afterwards
+  auto dead = graph.addPass("dead", noop);
+  dead.sample(c).writeColor(unused, VK_ATTACHMENT_LOAD_OP_LOAD);
+  auto compose = graph.addPass("compose", noop);
+  compose.sample(c).writeColor(backbuffer, VK_ATTACHMENT_LOAD_OP_CLEAR);
+  graph.compile();
+
+  check(!graph.isCulled(passA.getId()), "write a is kept");
+  check(!graph.isCulled(passB.getId()), "a to b is kept");
+  check(!graph.isCulled(passC.getId()), "b to c is kept");
+  check(graph.isCulled(dead.getId()), "dead is culled");
+  check(!graph.isCulled(compose.getId()), "compose is kept");
+
+  const VkImageLayout undefined = VK_IMAGE_LAYOUT_UNDEFINED;
+  const VkImageLayout attachment = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+  const VkImageLayout sampled = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+  const auto &barriersA = graph.getBarriers(passA.getId());
+  check(barriersA.size() == 1, "write a has one barrier");
+  if (barriersA.size() == 1) {
+    checkBarrier(barriersA[0], a, undefined, attachment, "first use of a");
+  }
+  const auto &barriersB = graph.getBarriers(passB.getId());
+  check(barriersB.size() == 2, "a to b has two barriers");
+  if (barriersB.size() == 2) {
+    checkBarrier(barriersB[0], a, attachment, sampled, "read of a");
+    check(barriersB[0].srcAccess == VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+          "read of a waits for its write");
+    checkBarrier(barriersB[1], b, undefined, attachment, "first use of b");
+  }
+  const auto &barriersC = graph.getBarriers(passC.getId());
+  check(barriersC.size() == 2, "b to c has two barriers");
+  if (barriersC.size() == 2) {
+    checkBarrier(barriersC[0], b, attachment, sampled, "read of b");
+    checkBarrier(barriersC[1], c, undefined, attachment, "first use of c");
+    // c takes over a's memory once a's last reader is done
+    check(barriersC[1].srcStages == VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+          "first use of c waits for the last read of a");
+  }
+  check(graph.getBarriers(dead.getId()).empty(), "dead has no barriers");
+  const auto &barriersCompose = graph.getBarriers(compose.getId());
+  check(barriersCompose.size() == 2, "compose has two barriers");
+  if (barriersCompose.size() == 2) {
+    checkBarrier(barriersCompose[0], c, attachment, sampled, "read of c");
+    checkBarrier(barriersCompose[1], backbuffer, undefined, attachment,
+                 "first use of the backbuffer");
+  }
+
+  check(graph.getMemoryBlockCount() == 2, "two allocations");
+  check(graph.getMemoryBlock(a) != Graph::NO_MEMORY_BLOCK, "a is placed");
+  check(graph.getMemoryBlock(a) == graph.getMemoryBlock(c),
+        "a and c share memory");
+  check(graph.getMemoryBlock(a) != graph.getMemoryBlock(b),
+        "a and b do not share memory");
+  check(graph.getMemoryBlock(unused) == Graph::NO_MEMORY_BLOCK,
+        "the culled output is not allocated");
+  check(graph.getMemoryBlock(backbuffer) == Graph::NO_MEMORY_BLOCK,
+        "the backbuffer is not allocated");
+}
+
+} // namespace
+
+int main() {
+  try {
+    lve::LveWindow window{64, 64, "RenderGraphTest", true};
+    lve::LveDevice device{window};
+    lve::LveThreadPool threadPool{};
+    lve::LveRenderer renderer{window, device, threadPool};
+    testGraph(device, renderer);
+    device.waitIdle();
+  } catch (const std::exception &e) {
+    std::printf("FAIL: %s\n", e.what());
+    return EXIT_FAILURE;
+  }
+
+  if (failures > 0) {
+    std::printf("%d checks failed\n", failures);
+    return EXIT_FAILURE;
+  }
+  std::printf("render graph: all checks passed\n");
+  return EXIT_SUCCESS;
+}